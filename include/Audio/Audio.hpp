@@ -1,7 +1,21 @@
 #pragma once
 
+#include "../../src/AudioData.hpp"
+#include "../../src/AudioLoader.hpp"
+#include "../../src/DevicesRegistry.hpp"
+#include "../../src/DuplexStream.hpp"
+#include "../../src/FixedSizeFft.hpp"
 #include "../../src/InputStream.hpp"
+#include "../../src/Mixer.hpp"
+#include "../../src/PlaybackClock.hpp"
+#include "../../src/Processor.hpp"
 #include "../../src/Player.hpp"
+#include "../../src/Recorder.hpp"
+#include "../../src/SeekTable.hpp"
+#include "../../src/StreamController.hpp"
+#include "../../src/Tracer.hpp"
 #include "../../src/compute_volume.hpp"
+#include "../../src/constant_q_transform.hpp"
 #include "../../src/fourier_transform.hpp"
+#include "../../src/frequency_bands.hpp"
 #include "../../src/load_audio_file.hpp"
\ No newline at end of file
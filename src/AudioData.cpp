@@ -0,0 +1,43 @@
+#include "AudioData.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace Audio {
+
+static constexpr float int16_max = 32767.f;
+
+void AudioData::compact()
+{
+    if (samples.empty())
+        return;
+    compact_samples.resize(samples.size());
+    std::transform(samples.begin(), samples.end(), compact_samples.begin(), [](float const sample) {
+        return static_cast<int16_t>(std::lround(std::clamp(sample, -1.f, 1.f) * int16_max));
+    });
+    samples = {}; // Actually frees the memory, unlike clear()
+}
+
+auto AudioData::sample(size_t sample_index) const -> float
+{
+    if (!compact_samples.empty())
+        return static_cast<float>(compact_samples[sample_index]) / int16_max;
+    return samples[sample_index];
+}
+
+void AudioData::read_samples(size_t first_sample_index, std::span<float> destination) const
+{
+    assert(first_sample_index + destination.size() <= samples_count());
+    if (compact_samples.empty())
+    {
+        std::copy_n(samples.begin() + static_cast<std::ptrdiff_t>(first_sample_index), destination.size(), destination.begin());
+        return;
+    }
+
+    // Simple enough to be vectorized by the compiler (int16 -> float conversion and multiplication, several samples at once).
+    auto const source = std::span{compact_samples}.subspan(first_sample_index, destination.size());
+    for (size_t i = 0; i < destination.size(); ++i)
+        destination[i] = static_cast<float>(source[i]) * (1.f / int16_max);
+}
+
+} // namespace Audio
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "SeekTable.hpp"
+
+namespace Audio {
+
+enum class SampleStorage {
+    /// 32-bit float. Exact, but uses 4 bytes per sample.
+    Float32,
+    /// 16-bit PCM. Uses half the memory, with a precision that is still transparent for playback and analysis (it is the precision of CDs).
+    Int16,
+};
+
+struct AudioData {
+    /// All the samples. If `channels_count` is > 1, the data MUST be in interleaved format:
+    /// [Frame 0 | Channel 0]
+    /// [Frame 0 | Channel 1]
+    /// [Frame 1 | Channel 0]
+    /// [Frame 1 | Channel 1]
+    /// For a definition of Frame, see https://youtu.be/jNSiZqSQis4?t=937
+    /// Empty if the data is stored in `compact_samples` instead.
+    std::vector<float> samples{};
+
+    /// Same as `samples`, but stored as 16-bit PCM, which uses half the memory. See `compact()`.
+    /// Only one of `samples` and `compact_samples` is used at a time.
+    std::vector<int16_t> compact_samples{};
+
+    /// The number of frames per second.
+    unsigned int sample_rate{};
+
+    /// The number of channels (usually 1 or 2, mono or stereo).
+    unsigned int channels_count{};
+
+    /// Where each moment of the data is located in the file it has been loaded from. Only set if you asked `load_audio_file()` to build it.
+    /// Shared, because the table of a given file can be cached (see `SeekTableMode::Cached`).
+    std::shared_ptr<SeekTable const> seek_table{};
+
+    /// Converts the samples to 16-bit PCM and frees the 32-bit ones. Does nothing if the data is already compact.
+    void compact();
+    [[nodiscard]] auto storage() const -> SampleStorage { return compact_samples.empty() ? SampleStorage::Float32 : SampleStorage::Int16; }
+
+    /// The number of samples, whatever the storage (so this is `frames count * channels_count`).
+    [[nodiscard]] auto samples_count() const -> size_t { return samples.size() + compact_samples.size(); }
+    /// The number of bytes used by the samples.
+    [[nodiscard]] auto memory_usage() const -> size_t { return samples.size() * sizeof(float) + compact_samples.size() * sizeof(int16_t); }
+    /// Returns the sample at the given index, whatever the storage.
+    [[nodiscard]] auto sample(size_t sample_index) const -> float;
+    /// Copies (and converts if needed) the samples [first_sample_index, first_sample_index + destination.size()) into `destination`.
+    /// This is much faster than calling `sample()` for each sample. The range MUST be valid.
+    void read_samples(size_t first_sample_index, std::span<float> destination) const;
+};
+
+} // namespace Audio
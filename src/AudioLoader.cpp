@@ -0,0 +1,202 @@
+#include "AudioLoader.hpp"
+#include <algorithm>
+#include <optional>
+#include "Tracer.hpp"
+#include "load_audio_file.hpp"
+
+namespace Audio {
+
+auto AudioLoader::default_workers_count() -> size_t
+{
+    return std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+}
+
+AudioLoader::AudioLoader(size_t workers_count, size_t memory_budget_in_bytes)
+    : _memory_budget{memory_budget_in_bytes}
+{
+    _workers.reserve(workers_count);
+    for (size_t i = 0; i < std::max<size_t>(workers_count, 1); ++i)
+        _workers.emplace_back([this]() { worker_thread_loop(); });
+}
+
+AudioLoader::~AudioLoader()
+{
+    {
+        std::lock_guard const lock{_mutex};
+        _should_stop = true;
+    }
+    _cv.notify_all();
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+auto AudioLoader::load(std::filesystem::path const& path, SampleStorage storage) -> AudioDataFuture
+{
+    return load(path, storage, {});
+}
+
+auto AudioLoader::load(std::filesystem::path const& path, SampleStorage storage, OnAudioLoaded on_loaded) -> AudioDataFuture
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    AUDIO_TRACE_SCOPE("AudioLoader::load");
+    auto key = Key{path.lexically_normal(), storage};
+
+    std::unique_lock lock{_mutex};
+    if (auto const it = _entries.find(key); it != _entries.end())
+    {
+        auto& entry = it->second;
+        _lru.splice(_lru.begin(), _lru, entry.lru_position); // Mark it as the most recently used.
+        auto future = entry.future;
+        if (!on_loaded)
+            return future;
+        if (!entry.is_loaded)
+        {
+            entry.callbacks.push_back(std::move(on_loaded));
+            return future;
+        }
+        lock.unlock(); // Don't hold the lock while running user code.
+        on_loaded(future.get(), nullptr);
+        return future;
+    }
+
+    auto promise = std::promise<std::shared_ptr<AudioData const>>{};
+    auto future  = promise.get_future().share();
+    _lru.push_front(key);
+    auto& entry        = _entries[key];
+    entry.future       = future;
+    entry.lru_position = _lru.begin();
+    if (on_loaded)
+        entry.callbacks.push_back(std::move(on_loaded));
+    _jobs.push_back({std::move(key), std::move(promise)});
+    lock.unlock();
+    _cv.notify_one();
+    return future;
+}
+
+auto AudioLoader::load(std::vector<std::filesystem::path> const& paths, SampleStorage storage) -> std::vector<AudioDataFuture>
+{
+    auto futures = std::vector<AudioDataFuture>{};
+    futures.reserve(paths.size());
+    for (auto const& path : paths)
+        futures.push_back(load(path, storage));
+    return futures;
+}
+
+void AudioLoader::worker_thread_loop()
+{
+    while (true)
+    {
+        auto job = [&]() -> std::optional<Job> {
+            std::unique_lock lock{_mutex};
+            _cv.wait(lock, [&]() { return _should_stop || !_jobs.empty(); });
+            if (_should_stop)
+                return std::nullopt;
+            auto res = std::move(_jobs.front());
+            _jobs.pop_front();
+            return res;
+        }();
+        if (!job)
+            return;
+
+        auto data  = std::shared_ptr<AudioData const>{};
+        auto error = std::exception_ptr{};
+        try
+        {
+            data = std::make_shared<AudioData const>(load_audio_file(job->key.first, job->key.second));
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        on_job_done(*job, data, error);
+    }
+}
+
+void AudioLoader::on_job_done(Job& job, std::shared_ptr<AudioData const> const& data, std::exception_ptr const& error)
+{
+    // Update the cache before fulfilling the promise, so that whoever waits for the file sees a cache that already accounts for it.
+    auto callbacks = std::vector<OnAudioLoaded>{};
+    {
+        std::lock_guard const lock{_mutex};
+        auto const it = _entries.find(job.key); // Can't have been removed: clear_cache() and evict_if_necessary() never touch the files that are still loading.
+        callbacks     = std::move(it->second.callbacks);
+        if (error)
+        {
+            // Don't keep the failure in the cache, so that the next request tries again (e.g. if the file was missing and has been created since).
+            _lru.erase(it->second.lru_position);
+            _entries.erase(it);
+        }
+        else
+        {
+            it->second.is_loaded    = true;
+            it->second.memory_usage = data->memory_usage();
+            _memory_usage += it->second.memory_usage;
+            evict_if_necessary();
+        }
+    }
+    if (error)
+        job.promise.set_exception(error);
+    else
+        job.promise.set_value(data);
+    for (auto const& callback : callbacks)
+        callback(data, error);
+}
+
+void AudioLoader::evict_if_necessary()
+{
+    auto it = _lru.end();
+    while (_memory_usage > _memory_budget && it != _lru.begin())
+    {
+        --it;
+        auto const entry = _entries.find(*it);
+        if (!entry->second.is_loaded)
+            continue;
+        _memory_usage -= entry->second.memory_usage;
+        _entries.erase(entry);
+        it = _lru.erase(it);
+    }
+}
+
+void AudioLoader::set_memory_budget(size_t memory_budget_in_bytes)
+{
+    std::lock_guard const lock{_mutex};
+    _memory_budget = memory_budget_in_bytes;
+    evict_if_necessary();
+}
+
+auto AudioLoader::memory_budget() const -> size_t
+{
+    std::lock_guard const lock{_mutex};
+    return _memory_budget;
+}
+
+auto AudioLoader::memory_usage() const -> size_t
+{
+    std::lock_guard const lock{_mutex};
+    return _memory_usage;
+}
+
+void AudioLoader::clear_cache()
+{
+    std::lock_guard const lock{_mutex};
+    for (auto it = _lru.begin(); it != _lru.end();)
+    {
+        auto const entry = _entries.find(*it);
+        if (!entry->second.is_loaded)
+        {
+            ++it;
+            continue;
+        }
+        _memory_usage -= entry->second.memory_usage;
+        _entries.erase(entry);
+        it = _lru.erase(it);
+    }
+}
+
+auto audio_loader() -> AudioLoader&
+{
+    static AudioLoader instance{};
+    return instance;
+}
+
+} // namespace Audio
@@ -0,0 +1,97 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "AudioData.hpp"
+
+namespace Audio {
+
+/// The data is shared (instead of copied) between the loader's cache, the Players and you, so that it is only stored once in memory.
+using AudioDataFuture = std::shared_future<std::shared_ptr<AudioData const>>;
+/// Receives the data, or the exception that was thrown while loading it (in which case `data` is nullptr).
+using OnAudioLoaded = std::function<void(std::shared_ptr<AudioData const> const& data, std::exception_ptr const& error)>;
+
+/// Decodes audio files on a pool of background threads, so that you can preload many tracks at once without blocking the main thread.
+/// The decoded files are kept in a cache, so loading the same file twice only decodes it once.
+/// When the cache uses more memory than its budget, the least recently requested files are evicted from it.
+/// (Evicting a file only drops the cache's reference to it: Players and futures that still use it keep it alive).
+class AudioLoader {
+public:
+    /// Starts `workers_count` threads. By default, uses half of the cores (between 1 and 4 threads), so that decoding doesn't starve the rest of the application.
+    explicit AudioLoader(size_t workers_count = default_workers_count(), size_t memory_budget_in_bytes = 1024 * 1024 * 1024);
+    /// Finishes the loads that are in progress, and abandons the ones that haven't started yet (their futures will throw a `std::future_error`).
+    ~AudioLoader();
+    AudioLoader(AudioLoader const&)                        = delete; //
+    auto operator=(AudioLoader const&) -> AudioLoader&     = delete; // Can't copy nor move
+    AudioLoader(AudioLoader&&) noexcept                    = delete; // because the worker threads use the address of this object.
+    auto operator=(AudioLoader&&) noexcept -> AudioLoader& = delete; //
+
+    /// Never blocks: the file is decoded on a worker thread, and the future becomes ready once it is done.
+    /// If the loading fails (e.g. if the file is not found), the future will rethrow the exception.
+    /// You can give the future to `Player::set_audio_data()` right away, the player will start using the data as soon as it is ready.
+    auto load(std::filesystem::path const&, SampleStorage = SampleStorage::Float32) -> AudioDataFuture;
+    /// Same as above, and also calls `on_loaded` once the loading is done.
+    /// /!\ `on_loaded` is called on a worker thread (or immediately, on the calling thread, if the file was already in the cache).
+    auto load(std::filesystem::path const&, SampleStorage, OnAudioLoaded on_loaded) -> AudioDataFuture;
+    /// Loads all the files concurrently. They are started in the order of the list.
+    auto load(std::vector<std::filesystem::path> const&, SampleStorage = SampleStorage::Float32) -> std::vector<AudioDataFuture>;
+
+    /// The maximum number of bytes used by the samples of all the cached files. Files that are still loading are not taken into account.
+    void set_memory_budget(size_t memory_budget_in_bytes);
+    [[nodiscard]] auto memory_budget() const -> size_t;
+    /// The number of bytes used by the samples of all the cached files.
+    [[nodiscard]] auto memory_usage() const -> size_t;
+    /// Removes all the loaded files from the cache. The ones that are still loading are not affected.
+    void clear_cache();
+
+    [[nodiscard]] static auto default_workers_count() -> size_t;
+
+private:
+    using Key = std::pair<std::filesystem::path, SampleStorage>;
+
+    struct Entry {
+        AudioDataFuture            future;
+        bool                       is_loaded{false};
+        size_t                     memory_usage{0};
+        std::vector<OnAudioLoaded> callbacks{};
+        std::list<Key>::iterator   lru_position;
+    };
+
+    struct Job {
+        Key                                            key;
+        std::promise<std::shared_ptr<AudioData const>> promise;
+    };
+
+    void worker_thread_loop();
+    void on_job_done(Job&, std::shared_ptr<AudioData const> const&, std::exception_ptr const&);
+    /// /!\ `_mutex` must be locked.
+    void evict_if_necessary();
+
+private:
+    mutable std::mutex      _mutex{};
+    std::condition_variable _cv{};
+    std::deque<Job>         _jobs{};
+    bool                    _should_stop{false};
+
+    std::map<Key, Entry> _entries{};
+    std::list<Key>       _lru{}; // The most recently requested file comes first.
+    size_t               _memory_budget;
+    size_t               _memory_usage{0};
+
+    std::vector<std::thread> _workers; // Must be declared last, so that the threads start after all the other members are initialized.
+};
+
+/// Global instance, for convenience.
+auto audio_loader() -> AudioLoader&;
+
+} // namespace Audio
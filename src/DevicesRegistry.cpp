@@ -0,0 +1,194 @@
+#include "DevicesRegistry.hpp"
+#include <algorithm>
+#include "Tracer.hpp"
+
+namespace Audio {
+
+auto DevicesSnapshot::find_device(unsigned int device_id) const -> RtAudio::DeviceInfo const*
+{
+    auto const it = std::find_if(devices.begin(), devices.end(), [&](RtAudio::DeviceInfo const& info) {
+        return info.ID == device_id;
+    });
+    return it != devices.end() ? &*it : nullptr;
+}
+
+auto DevicesSnapshot::find_device(std::string const& name) const -> RtAudio::DeviceInfo const*
+{
+    auto const it = std::find_if(devices.begin(), devices.end(), [&](RtAudio::DeviceInfo const& info) {
+        return info.name == name;
+    });
+    return it != devices.end() ? &*it : nullptr;
+}
+
+auto DevicesSnapshot::find_device(SelectedDevice const& device, unsigned int default_device_id) const -> RtAudio::DeviceInfo const*
+{
+    return std::holds_alternative<UseDefaultDevice>(device)
+               ? find_device(default_device_id)
+               : find_device(std::get<UseGivenDevice>(device).name);
+}
+
+static auto is_same_device(RtAudio::DeviceInfo const& a, RtAudio::DeviceInfo const& b) -> bool
+{
+    return a.ID == b.ID
+           && a.name == b.name
+           && a.inputChannels == b.inputChannels
+           && a.outputChannels == b.outputChannels
+           && a.duplexChannels == b.duplexChannels
+           && a.preferredSampleRate == b.preferredSampleRate
+           && a.sampleRates == b.sampleRates;
+}
+
+static auto is_same_snapshot(DevicesSnapshot const& a, DevicesSnapshot const& b) -> bool
+{
+    return a.default_input_device_id == b.default_input_device_id
+           && a.default_output_device_id == b.default_output_device_id
+           && std::equal(a.devices.begin(), a.devices.end(), b.devices.begin(), b.devices.end(), &is_same_device);
+}
+
+auto probe_devices(RtAudio& backend) -> DevicesSnapshot
+{
+    auto snapshot = DevicesSnapshot{};
+    for (auto const id : backend.getDeviceIds())
+        snapshot.devices.push_back(backend.getDeviceInfo(id));
+    snapshot.default_input_device_id  = backend.getDefaultInputDevice();
+    snapshot.default_output_device_id = backend.getDefaultOutputDevice();
+    return snapshot;
+}
+
+DevicesRegistry::DevicesRegistry(DevicesProbe probe)
+    : _probe{std::move(probe)}
+    , _thread{[this]() { background_thread_loop(); }}
+{
+    // Wait for the first snapshot, so that users never see an empty list just because the background thread hasn't had time to run yet.
+    std::unique_lock lock{_thread_mutex};
+    _thread_cv.wait(lock, [&]() { return generation() != 0; });
+}
+
+DevicesRegistry::~DevicesRegistry()
+{
+    {
+        std::lock_guard const lock{_thread_mutex};
+        _should_stop = true;
+    }
+    _thread_cv.notify_all();
+    _thread.join();
+}
+
+auto DevicesRegistry::snapshot() const -> std::shared_ptr<DevicesSnapshot const>
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_snapshot_mutex};
+    return _snapshot;
+}
+
+auto DevicesRegistry::subscribe(DevicesListener listener) -> DevicesListenerId
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_listeners_mutex};
+    auto const            id = _next_listener_id++;
+    _listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void DevicesRegistry::unsubscribe(DevicesListenerId id)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_listeners_mutex};
+    std::erase_if(_listeners, [&](auto const& listener) { return listener.first == id; });
+}
+
+void DevicesRegistry::request_refresh()
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    {
+        std::lock_guard const lock{_thread_mutex};
+        _refresh_requested = true;
+    }
+    _thread_cv.notify_all();
+}
+
+void DevicesRegistry::set_refresh_interval(std::chrono::milliseconds interval)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    {
+        std::lock_guard const lock{_thread_mutex};
+        _refresh_interval = interval;
+    }
+    _thread_cv.notify_all();
+}
+
+void DevicesRegistry::set_error_callback(RtAudioErrorCallback callback)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_thread_mutex};
+    _error_callback = std::move(callback);
+}
+
+void DevicesRegistry::publish(DevicesSnapshot snapshot)
+{
+    snapshot.generation = generation() + 1;
+    auto const shared   = std::make_shared<DevicesSnapshot const>(std::move(snapshot));
+    {
+        std::lock_guard const lock{_snapshot_mutex};
+        _snapshot = shared;
+    }
+    {
+        std::lock_guard const lock{_thread_mutex}; // Needed so that the constructor can't miss the notification.
+        _generation.store(shared->generation, std::memory_order_release); // Only once the snapshot is available, so that someone who sees the new generation is guaranteed to get the new snapshot.
+    }
+    _thread_cv.notify_all();
+
+    std::lock_guard const lock{_listeners_mutex};
+    for (auto const& [id, listener] : _listeners)
+        listener(*shared);
+}
+
+void DevicesRegistry::background_thread_loop()
+{
+    // The backend is created on this thread and only ever used here, because some APIs (e.g. WASAPI) require it to be used from the thread that created it.
+    RtAudio backend{
+        RtAudio::Api::UNSPECIFIED,
+        [this](RtAudioErrorType type, std::string const& message) {
+            auto const callback = [&]() {
+                std::lock_guard const lock{_thread_mutex};
+                return _error_callback;
+            }();
+            if (callback)
+                callback(type, message);
+        }
+    };
+
+    while (true)
+    {
+        {
+            AUDIO_TRACE_SCOPE("Probing the devices");
+            auto snapshot = _probe(backend);
+            if (generation() == 0 || !is_same_snapshot(snapshot, *this->snapshot()))
+                publish(std::move(snapshot));
+        }
+
+        std::unique_lock lock{_thread_mutex};
+        _thread_cv.wait_for(lock, _refresh_interval, [&]() { return _should_stop || _refresh_requested; });
+        if (_should_stop)
+            return;
+        _refresh_requested = false;
+    }
+}
+
+auto devices_registry() -> DevicesRegistry&
+{
+    static DevicesRegistry instance{};
+    return instance;
+}
+
+auto backend_device_id(RtAudio& backend, std::string const& device_name) -> unsigned int
+{
+    for (auto const id : backend.getDeviceIds())
+    {
+        if (backend.getDeviceInfo(id).name == device_name)
+            return id;
+    }
+    return 0;
+}
+
+} // namespace Audio
@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+#include "rtaudio/RtAudio.h"
+
+namespace Audio {
+
+struct UseDefaultDevice {};
+struct UseGivenDevice {
+    std::string name;
+};
+using SelectedDevice = std::variant<UseDefaultDevice, UseGivenDevice>;
+
+/// The list of all the audio devices at a given moment in time.
+/// /!\ The IDs are only meaningful for the registry: they might not match the IDs of another RtAudio instance. Use the names to identify devices.
+struct DevicesSnapshot {
+    std::vector<RtAudio::DeviceInfo> devices{};
+    unsigned int                     default_input_device_id{0};  // 0 if there is none
+    unsigned int                     default_output_device_id{0}; // 0 if there is none
+    /// Increases by one each time the list of devices (or the default devices) changes.
+    uint64_t                         generation{0};
+
+    /// Returns nullptr if the device is not found.
+    [[nodiscard]] auto find_device(unsigned int device_id) const -> RtAudio::DeviceInfo const*;
+    /// Returns nullptr if the device is not found.
+    [[nodiscard]] auto find_device(std::string const& name) const -> RtAudio::DeviceInfo const*;
+    /// Returns nullptr if the device is not found. `default_device_id` is the device to use for `UseDefaultDevice`.
+    [[nodiscard]] auto find_device(SelectedDevice const&, unsigned int default_device_id) const -> RtAudio::DeviceInfo const*;
+};
+
+/// Asks `backend` for the current list of devices. This is slow.
+[[nodiscard]] auto probe_devices(RtAudio& backend) -> DevicesSnapshot;
+/// Computes the current list of devices. Called on the background thread of the registry.
+using DevicesProbe = std::function<DevicesSnapshot(RtAudio&)>;
+
+/// Called with the new list of devices, each time it changes.
+using DevicesListener = std::function<void(DevicesSnapshot const&)>;
+/// Identifies a listener, so that it can be removed.
+using DevicesListenerId = uint64_t;
+
+/// Probing the audio devices is slow (it asks the OS about each device), so instead of doing it every frame we do it on a background thread, at a throttled rate.
+/// You can then get the latest list of devices for free, and know if it has changed since the last time you looked by checking the `generation()`.
+/// Or, if you would rather be notified than poll, you can `subscribe()` a listener.
+class DevicesRegistry {
+public:
+    /// Blocks until the first list of devices is available.
+    /// You can give your own `probe` (e.g. to simulate some devices in the tests).
+    explicit DevicesRegistry(DevicesProbe probe = &probe_devices);
+    ~DevicesRegistry();
+    DevicesRegistry(DevicesRegistry const&)                        = delete; //
+    auto operator=(DevicesRegistry const&) -> DevicesRegistry&     = delete; // Can't copy nor move
+    DevicesRegistry(DevicesRegistry&&) noexcept                    = delete; // because the background thread uses the address of this object.
+    auto operator=(DevicesRegistry&&) noexcept -> DevicesRegistry& = delete; //
+
+    /// Cheap (a single atomic load), you can call it every frame.
+    /// It changes each time the list of devices changes, so you can compare it with the last value you saw to know if you need to react to a change.
+    [[nodiscard]] auto generation() const -> uint64_t { return _generation.load(std::memory_order_acquire); }
+    /// Returns the latest list of devices. Cheap: it doesn't probe anything, it just shares the list computed by the background thread.
+    [[nodiscard]] auto snapshot() const -> std::shared_ptr<DevicesSnapshot const>;
+
+    /// `listener` will be called on the background thread each time the list of devices changes (but not for the current list, use `snapshot()` to get it).
+    /// It must be quick, because it delays the next refresh, and it must not call `subscribe()` nor `unsubscribe()`.
+    [[nodiscard]] auto subscribe(DevicesListener listener) -> DevicesListenerId;
+    /// Once this returns, the listener won't be called anymore (if it was currently running, we wait for it to finish), so whatever it references can safely be destroyed.
+    void unsubscribe(DevicesListenerId);
+
+    /// Asks the background thread to refresh the list as soon as possible, instead of waiting for the next refresh.
+    void request_refresh();
+    /// How often the background thread refreshes the list. Defaults to 1 second.
+    void set_refresh_interval(std::chrono::milliseconds);
+    /// Receives the errors that happen while probing the devices.
+    void set_error_callback(RtAudioErrorCallback);
+
+private:
+    void background_thread_loop();
+    void publish(DevicesSnapshot);
+
+private:
+    DevicesProbe                           _probe;
+    std::atomic<uint64_t>                  _generation{0};
+    std::shared_ptr<DevicesSnapshot const> _snapshot{std::make_shared<DevicesSnapshot const>()};
+    mutable std::mutex                     _snapshot_mutex{};
+
+    std::vector<std::pair<DevicesListenerId, DevicesListener>> _listeners{};
+    DevicesListenerId                                          _next_listener_id{1};
+    std::mutex                                                 _listeners_mutex{}; // Held while the listeners are called, so that unsubscribe() can wait for them.
+
+    std::mutex                _thread_mutex{};
+    std::condition_variable   _thread_cv{};
+    std::chrono::milliseconds _refresh_interval{1000};
+    bool                      _refresh_requested{false};
+    bool                      _should_stop{false};
+    RtAudioErrorCallback      _error_callback{};
+
+    std::thread _thread; // Must be declared last, so that it starts after all the other members are initialized.
+};
+
+/// Global instance, shared by all the InputStreams and the Player.
+auto devices_registry() -> DevicesRegistry&;
+
+/// The IDs of the registry are not necessarily the same as the ones of another backend, so we translate them using the name of the device.
+/// Returns 0 if the backend doesn't have a device with that name.
+/// This probes all the devices of `backend`, so only do it when actually opening a stream.
+auto backend_device_id(RtAudio& backend, std::string const& device_name) -> unsigned int;
+
+} // namespace Audio
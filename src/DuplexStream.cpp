@@ -0,0 +1,225 @@
+#include "DuplexStream.hpp"
+#include <algorithm>
+#include <span>
+#include <thread>
+#include <tuple>
+#include "Tracer.hpp"
+
+namespace Audio {
+
+static constexpr unsigned int max_output_channels_count = 2; // Stereo, or mono if the output device only has one channel.
+
+DuplexStream::DuplexStream(RtAudioErrorCallback error_callback)
+    : _controller{std::move(error_callback)}
+{
+    std::ignore = devices_registry(); // Start probing the devices right away.
+}
+
+DuplexStream::~DuplexStream()
+{
+    close();
+    _controller.wait_until_idle();
+}
+
+void DuplexStream::update()
+{
+    AUDIO_TRACE_SCOPE("DuplexStream::update");
+    // Fast path, taken almost every frame: a single atomic load, no device probing.
+    // We also check every few seconds, in case the stream has failed to open or has been stopped by the backend.
+    auto const devices_generation = devices_registry().generation();
+    if (devices_generation == _devices_generation && !_controller.is_time_for_periodic_check())
+        return;
+    _devices_generation = devices_generation;
+
+    auto const  devices       = devices_registry().snapshot();
+    auto const* input_device  = devices->find_device(_input_device, devices->default_input_device_id);
+    auto const* output_device = devices->find_device(_output_device, devices->default_output_device_id);
+    if (!input_device || !output_device) // One of the devices has been removed, we will check again when it comes back (i.e. when the registry changes) or at the next periodic check.
+        return;
+
+    _controller.open(
+        [this, input_name = input_device->name, output_name = output_device->name](RtAudio& backend) { // Already using these devices, nothing to do.
+            return backend.isStreamRunning() && input_name == _opened_input_device_name && output_name == _opened_output_device_name;
+        },
+        [this, input_device = *input_device, output_device = *output_device](RtAudio& backend) {
+            return open_stream(backend, input_device, output_device);
+        }
+    );
+}
+
+void DuplexStream::add(Processor& processor)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_processors_mutex};
+    if (_format.sample_rate != 0) // The stream is already open, so the processor won't be prepared until the stream is reopened: do it now.
+        processor.prepare(_format);
+    _processors.push_back(&processor);
+    publish_processors();
+}
+
+void DuplexStream::remove(Processor& processor)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_processors_mutex};
+    std::erase(_processors, &processor);
+    publish_processors(); // Once this returns, the audio thread can't be using `processor` anymore, so it can safely be destroyed.
+}
+
+void DuplexStream::publish_processors()
+{
+    auto new_processors = std::make_unique<std::vector<Processor*> const>(_processors);
+    _processors_for_audio_thread.store(new_processors.get(), std::memory_order_seq_cst);
+
+    // If a callback has started before we published the new chain, it might still be using the old one: wait for it to finish.
+    // Callbacks that start after this point will see the new chain.
+    auto const counter = _rendering_counter.load(std::memory_order_seq_cst);
+    if (counter % 2 == 1)
+    {
+        while (_rendering_counter.load(std::memory_order_seq_cst) == counter)
+            std::this_thread::yield();
+    }
+
+    _published_processors = std::move(new_processors); // Destroys the old chain, nobody uses it anymore.
+}
+
+void DuplexStream::use_input_device(SelectedDevice device)
+{
+    _input_device       = std::move(device);
+    _devices_generation = 0; // Make sure the next update() switches to the new device.
+}
+
+void DuplexStream::use_output_device(SelectedDevice device)
+{
+    _output_device      = std::move(device);
+    _devices_generation = 0; // Make sure the next update() switches to the new device.
+}
+
+void DuplexStream::set_frames_per_buffer(unsigned int frames_count)
+{
+    _controller.post([this, frames_count](RtAudio&) {
+        _requested_frames_per_buffer = std::max(frames_count, 1u);
+        _opened_input_device_name.clear(); // Force the stream to be reopened with the new buffer size.
+    });
+    _devices_generation = 0; // Make sure the next update() reopens the stream.
+}
+
+void DuplexStream::close()
+{
+    _controller.post([this](RtAudio&) {
+        std::lock_guard const lock{_processors_mutex};
+        _format = {};
+    });
+    _controller.close();
+    _sample_rate.store(0, std::memory_order_release);
+    _frames_per_buffer.store(0, std::memory_order_release);
+    _devices_generation = 0; // Like before the stream was first opened: the next update() will open it again.
+}
+
+auto duplex_callback(void* output_buffer, void* input_buffer, unsigned int frames_count, double /* stream_time */, RtAudioStreamStatus status, void* user_data) -> int
+{
+    AUDIO_TRACE_SCOPE("DuplexStream callback");
+    AUDIO_REALTIME_SCOPE();
+    auto&       This            = *static_cast<DuplexStream*>(user_data);
+    auto const  output_channels = This._output_channels_count;
+    auto const  output          = std::span{static_cast<float*>(output_buffer), static_cast<size_t>(frames_count) * output_channels};
+    auto const* input           = static_cast<float const*>(input_buffer);
+    auto const  input_channels  = This._input_channels_count;
+    if (status != 0)
+        This._xruns_count.fetch_add(1, std::memory_order_relaxed);
+
+    // Route the input to the output.
+    for (size_t frame = 0; frame < frames_count; ++frame)
+    {
+        for (size_t channel = 0; channel < output_channels; ++channel)
+        {
+            output[frame * output_channels + channel] = input
+                                                            ? input[frame * input_channels + std::min<size_t>(channel, input_channels - 1)] // NOLINT(*pointer-arithmetic)
+                                                            : 0.f;
+        }
+    }
+
+    This._rendering_counter.fetch_add(1, std::memory_order_seq_cst); // Now odd: we are processing
+    for (Processor* processor : *This._processors_for_audio_thread.load(std::memory_order_seq_cst))
+        processor->process(output, output_channels);
+    This._rendering_counter.fetch_add(1, std::memory_order_seq_cst); // Now even: we are done
+    return 0;
+}
+
+/// In a duplex stream both devices run at the same rate, so we need one that they both support.
+/// Returns 0 if there is none.
+static auto common_sample_rate(RtAudio::DeviceInfo const& input_device, RtAudio::DeviceInfo const& output_device) -> unsigned int
+{
+    auto const supports = [](RtAudio::DeviceInfo const& info, unsigned int sample_rate) {
+        return info.sampleRates.empty() // Some APIs don't report the sample rates, we can only try.
+               || std::find(info.sampleRates.begin(), info.sampleRates.end(), sample_rate) != info.sampleRates.end();
+    };
+    if (supports(input_device, output_device.preferredSampleRate))
+        return output_device.preferredSampleRate;
+    if (supports(output_device, input_device.preferredSampleRate))
+        return input_device.preferredSampleRate;
+    for (auto const sample_rate : output_device.sampleRates)
+    {
+        if (supports(input_device, sample_rate))
+            return sample_rate;
+    }
+    return 0;
+}
+
+auto DuplexStream::open_stream(RtAudio& backend, RtAudio::DeviceInfo const& input_device, RtAudio::DeviceInfo const& output_device) -> bool
+{
+    if (backend.isStreamOpen())
+        backend.closeStream(); // Close the current stream if there was one. We want to reopen one with the new devices.
+    _opened_input_device_name.clear();
+    _opened_output_device_name.clear();
+    _sample_rate.store(0, std::memory_order_release);
+    _frames_per_buffer.store(0, std::memory_order_release);
+
+    auto const input_device_id  = backend_device_id(backend, input_device.name);
+    auto const output_device_id = backend_device_id(backend, output_device.name);
+    auto const sample_rate      = common_sample_rate(input_device, output_device);
+    if (input_device_id == 0 || output_device_id == 0 || sample_rate == 0)
+        return false;
+
+    RtAudio::StreamParameters input_parameters;
+    input_parameters.deviceId  = input_device_id;
+    input_parameters.nChannels = std::clamp(max_output_channels_count, 1u, std::max(input_device.inputChannels, 1u));
+    RtAudio::StreamParameters output_parameters;
+    output_parameters.deviceId  = output_device_id;
+    output_parameters.nChannels = std::clamp(max_output_channels_count, 1u, std::max(output_device.outputChannels, 1u));
+    RtAudio::StreamOptions options;
+    options.flags           = RTAUDIO_MINIMIZE_LATENCY | RTAUDIO_SCHEDULE_REALTIME;
+    options.numberOfBuffers = 2; // The minimum, for the APIs that let us choose.
+    unsigned int frames_count{_requested_frames_per_buffer};
+    if (backend.openStream(&output_parameters, &input_parameters, RTAUDIO_FLOAT32, sample_rate, &frames_count, &duplex_callback, this, &options) != RTAUDIO_NO_ERROR)
+        return false;
+
+    // The stream is open but not started yet, so the audio thread can't be using the processors.
+    _input_channels_count  = input_parameters.nChannels;
+    _output_channels_count = output_parameters.nChannels;
+    {
+        std::lock_guard const lock{_processors_mutex};
+        _format = {.sample_rate = sample_rate, .channels_count = output_parameters.nChannels, .max_frames_count = frames_count};
+        for (Processor* processor : _processors)
+            processor->prepare(_format);
+    }
+    _xruns_count.store(0, std::memory_order_release);
+
+    if (backend.startStream() != RTAUDIO_NO_ERROR)
+    {
+        backend.closeStream();
+        return false;
+    }
+
+    auto const latency_in_frames = backend.getStreamLatency(); // Not all APIs can report it, in which case we assume it's at least the size of our buffer.
+    _round_trip_latency_in_seconds.store(
+        static_cast<double>(latency_in_frames > 0 ? static_cast<unsigned long>(latency_in_frames) : frames_count) / static_cast<double>(sample_rate),
+        std::memory_order_release
+    );
+    _frames_per_buffer.store(frames_count, std::memory_order_release);
+    _sample_rate.store(sample_rate, std::memory_order_release);
+    _opened_input_device_name  = input_device.name;
+    _opened_output_device_name = output_device.name;
+    return true;
+}
+
+} // namespace Audio
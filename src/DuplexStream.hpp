@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DevicesRegistry.hpp"
+#include "Processor.hpp"
+#include "StreamController.hpp"
+#include "rtaudio/RtAudio.h"
+
+namespace Audio {
+
+/// Captures an input device and plays it on an output device through a single stream (and thus a single callback).
+/// This is what you want to monitor a microphone: the sound comes out of the speakers after a single buffer of latency, and the two devices can't drift apart.
+/// The output is stereo (or mono if the output device only has one channel).
+/// Each output channel receives the input channel with the same index (or the last input channel if there are less of them, e.g. a mono microphone goes to both speakers),
+/// and then the signal goes through all the processors, in the order they have been added.
+///
+/// /!\ Some APIs can't open a duplex stream on two different devices (e.g. CoreAudio needs an aggregate device).
+/// In that case `stream_state()` ends up being `StreamState::Failed`, and you need to select other devices.
+class DuplexStream {
+public:
+    explicit DuplexStream(RtAudioErrorCallback);
+    ~DuplexStream();
+    DuplexStream(DuplexStream const&)                        = delete; //
+    auto operator=(DuplexStream const&) -> DuplexStream&     = delete; // Can't copy nor move
+    DuplexStream(DuplexStream&&) noexcept                    = delete; // because we pass the address of this object to the audio callback.
+    auto operator=(DuplexStream&&) noexcept -> DuplexStream& = delete; //
+
+    /// Must be called every frame.
+    /// It is cheap unless the devices have changed (see `devices_registry()`), in which case it asks the control thread to reopen the stream.
+    /// It never blocks: opening the stream happens in the background, see `stream_state()`.
+    void update();
+
+    /// The audio thread never waits for these two functions.
+    /// But they might wait for the audio thread to finish the buffer it is currently processing (i.e. a few milliseconds at most), to make sure it doesn't use the old chain anymore.
+    /// Once `remove()` returns, the processor can safely be destroyed.
+    void add(Processor&);
+    void remove(Processor&);
+
+    /// Sets the input device to use. Defaults to the default input device selected by the OS.
+    void use_input_device(SelectedDevice);
+    /// Sets the output device to use. Defaults to the default output device selected by the OS.
+    void use_output_device(SelectedDevice);
+    /// The number of frames per buffer we ask the devices for. Defaults to 64.
+    /// Smaller buffers mean less latency, but a higher risk of glitches (see `xruns_count()`). The devices might not give us exactly that number.
+    void set_frames_per_buffer(unsigned int frames_count);
+
+    /// The sample rate of the stream, or 0 if there is no stream.
+    [[nodiscard]] auto sample_rate() const -> unsigned int { return _sample_rate.load(std::memory_order_acquire); }
+    /// The number of frames per buffer we actually got from the devices, or 0 if there is no stream.
+    [[nodiscard]] auto frames_per_buffer() const -> unsigned int { return _frames_per_buffer.load(std::memory_order_acquire); }
+    /// The time it takes for a sample to go from the microphone to the speakers, as reported by the devices.
+    [[nodiscard]] auto round_trip_latency_in_seconds() const -> double { return _round_trip_latency_in_seconds.load(std::memory_order_acquire); }
+    /// The number of callbacks where the devices have reported an input overflow or an output underflow (i.e. an audible glitch), since the stream was opened.
+    [[nodiscard]] auto xruns_count() const -> uint64_t { return _xruns_count.load(std::memory_order_acquire); }
+    /// Tells you if the stream is being opened, is running, has failed to open, etc.
+    /// All of that happens on a control thread, so that the main thread is never blocked.
+    [[nodiscard]] auto stream_state() const -> StreamState { return _controller.state(); }
+    /// Closes the stream. It will be reopened by the next call to `update()`.
+    /// NB: this happens asynchronously, on the control thread.
+    void close();
+
+private:
+    friend auto duplex_callback(void* output_buffer, void* input_buffer, unsigned int frames_count, double stream_time, RtAudioStreamStatus status, void* user_data) -> int;
+
+    /// Gives the new chain to the audio thread, and waits until it doesn't use the old one anymore.
+    void publish_processors();
+    /// /!\ Must only be called on the control thread.
+    auto open_stream(RtAudio&, RtAudio::DeviceInfo const& input_device, RtAudio::DeviceInfo const& output_device) -> bool;
+
+private:
+    // Processors
+    std::vector<Processor*>                        _processors{}; // The chain that `add()` and `remove()` modify.
+    std::mutex                                     _processors_mutex{};
+    StreamFormat                                   _format{}; // The format the processors have been prepared for. Protected by `_processors_mutex`.
+    std::unique_ptr<std::vector<Processor*> const> _published_processors{std::make_unique<std::vector<Processor*> const>()};
+    std::atomic<std::vector<Processor*> const*>    _processors_for_audio_thread{_published_processors.get()};
+    std::atomic<uint64_t>                          _rendering_counter{0}; // Incremented at the beginning and at the end of each callback, so it is odd iff the audio thread is processing.
+
+    // Only used on the audio thread (and on the control thread while the stream is stopped)
+    unsigned int _input_channels_count{1};
+    unsigned int _output_channels_count{2};
+
+    std::atomic<unsigned int> _sample_rate{0};
+    std::atomic<unsigned int> _frames_per_buffer{0};
+    std::atomic<double>       _round_trip_latency_in_seconds{0.};
+    std::atomic<uint64_t>     _xruns_count{0};
+
+    // Only used on the control thread
+    unsigned int _requested_frames_per_buffer{64};
+    std::string  _opened_input_device_name{};
+    std::string  _opened_output_device_name{};
+
+    // Only used on the main thread
+    SelectedDevice _input_device{UseDefaultDevice{}};
+    SelectedDevice _output_device{UseDefaultDevice{}};
+    uint64_t       _devices_generation{0}; // Generation of the devices registry last time we checked our devices.
+
+    StreamController _controller; // Must be declared last, so that its thread is stopped before the other members are destroyed.
+};
+
+} // namespace Audio
@@ -0,0 +1,154 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <utility>
+
+namespace Audio {
+
+/// An FFT whose size is known at compile time.
+/// The twiddle factors and the bit-reversal permutation are computed at compile time, and each stage is a separate function with constant loop bounds, so the compiler can unroll and vectorize them.
+/// It works in place, so you can keep your data on the stack (e.g. in a `std::array<std::complex<float>, N>`) and never allocate.
+/// Uses the same conventions as `fft()`: the exponent is positive and the output is scaled by 1 / sqrt(N).
+template<size_t N>
+    requires(N >= 4 && std::has_single_bit(N))
+class FixedSizeFft {
+public:
+    /// Computes the FFT of `data`, in place.
+    static void transform(std::span<std::complex<float>, N> data)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            auto const j = static_cast<size_t>(bit_reversed_indices[i]);
+            if (i < j)
+                std::swap(data[i], data[j]);
+        }
+        first_two_stages(data);
+        [&]<size_t... Stage>(std::index_sequence<Stage...>) {
+            (stage<(size_t{4} << Stage)>(data), ...);
+        }(std::make_index_sequence<static_cast<size_t>(std::countr_zero(N)) - 2>{});
+    }
+
+private:
+    /// The stages of size 2 and 4 only need the twiddle factors 1 and i, so we merge them into a single pass without any multiplication (apart from the normalization).
+    static void first_two_stages(std::span<std::complex<float>, N> data)
+    {
+        static constexpr float normalization = static_cast<float>(1. / constexpr_sqrt(static_cast<double>(N)));
+        for (size_t i = 0; i < N; i += 4)
+        {
+            auto const a0 = data[i] * normalization;
+            auto const a1 = data[i + 1] * normalization;
+            auto const a2 = data[i + 2] * normalization;
+            auto const a3 = data[i + 3] * normalization;
+            auto const b0 = a0 + a1;
+            auto const b1 = a0 - a1;
+            auto const b2 = a2 + a3;
+            auto const b3 = std::complex<float>{-(a2 - a3).imag(), (a2 - a3).real()}; // (a2 - a3) * i
+            data[i]       = b0 + b2;
+            data[i + 1]   = b1 + b3;
+            data[i + 2]   = b0 - b2;
+            data[i + 3]   = b1 - b3;
+        }
+    }
+
+    /// Combines pairs of transforms of size `Half` into transforms of size `2 * Half`.
+    template<size_t Half>
+    static void stage(std::span<std::complex<float>, N> data)
+    {
+        static constexpr size_t twiddle_stride = N / (2 * Half);
+        for (size_t block = 0; block < N; block += 2 * Half)
+        {
+            for (size_t k = 0; k < Half; ++k)
+            {
+                auto const t           = twiddles[k * twiddle_stride] * data[block + k + Half];
+                data[block + k + Half] = data[block + k] - t;
+                data[block + k]       += t;
+            }
+        }
+    }
+
+    /// std::sin, std::cos and std::sqrt are not constexpr (yet), so we need our own to build the tables at compile time.
+    /// Only valid for |x| <= pi / 4, where the Taylor series converges in a few terms.
+    static constexpr auto taylor_sin(double x) -> double
+    {
+        double term = x;
+        double sum  = x;
+        for (int n = 1; n < 10; ++n)
+        {
+            term *= -x * x / static_cast<double>((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+    static constexpr auto taylor_cos(double x) -> double
+    {
+        double term = 1.;
+        double sum  = 1.;
+        for (int n = 1; n < 10; ++n)
+        {
+            term *= -x * x / static_cast<double>((2 * n - 1) * (2 * n));
+            sum += term;
+        }
+        return sum;
+    }
+    static constexpr auto constexpr_sqrt(double x) -> double
+    {
+        double root = x;
+        for (int i = 0; i < 64; ++i) // Newton's method
+            root = (root + x / root) / 2.;
+        return root;
+    }
+
+    /// Returns exp(2 i pi k / N). The angle is reduced to the first octant with exact integer arithmetic, so that the results are as precise as std::polar's.
+    static constexpr auto unit_circle_point(size_t k) -> std::complex<double>
+    {
+        auto const quadrant        = (4 * k) / N;
+        auto const rest            = 4 * k - quadrant * N; // In [0, N), the angle inside the quadrant is pi/2 * rest / N
+        auto const angle           = std::numbers::pi / 2. * static_cast<double>(rest) / static_cast<double>(N);
+        auto const remaining_angle = std::numbers::pi / 2. * static_cast<double>(N - rest) / static_cast<double>(N);
+        auto const cos             = 2 * rest <= N ? taylor_cos(angle) : taylor_sin(remaining_angle);
+        auto const sin             = 2 * rest <= N ? taylor_sin(angle) : taylor_cos(remaining_angle);
+        switch (quadrant % 4)
+        {
+        case 0:
+            return {cos, sin};
+        case 1:
+            return {-sin, cos};
+        case 2:
+            return {-cos, -sin};
+        default:
+            return {sin, -cos};
+        }
+    }
+
+    static constexpr auto twiddles = [] {
+        auto res = std::array<std::complex<float>, N / 2>{};
+        for (size_t k = 0; k < N / 2; ++k)
+        {
+            auto const z = unit_circle_point(k);
+            res[k]       = {static_cast<float>(z.real()), static_cast<float>(z.imag())};
+        }
+        return res;
+    }();
+
+    static constexpr auto bit_reversed_indices = [] {
+        auto res = std::array<uint32_t, N>{};
+        for (size_t i = 0; i < N; ++i)
+        {
+            size_t reversed{0};
+            for (size_t bit = 1, mirror_bit = N / 2; bit < N; bit <<= 1, mirror_bit >>= 1)
+            {
+                if (i & bit)
+                    reversed |= mirror_bit;
+            }
+            res[i] = static_cast<uint32_t>(reversed);
+        }
+        return res;
+    }();
+};
+
+} // namespace Audio
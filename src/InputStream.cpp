@@ -1,45 +1,47 @@
 #include "InputStream.hpp"
-#include <mutex>
+#include <algorithm>
 #include <span>
+#include <stdexcept>
+#include <tuple>
 #include <variant>
+#include "Tracer.hpp"
 
 namespace Audio {
 
 InputStream::InputStream(RtAudioErrorCallback error_callback)
+    : _controller{std::move(error_callback)}
 {
-    _backend.setErrorCallback(std::move(error_callback));
+    std::ignore = devices_registry(); // Start probing the devices right away.
 }
 
 InputStream::~InputStream()
 {
     close();
+    _controller.wait_until_idle();
 }
 
 void InputStream::update()
 {
-    if (std::holds_alternative<UseDefaultDevice>(_selected_device))
-    {
-        auto const default_device_id = _backend.getDefaultInputDevice();
-        if (default_device_id != _current_device_id || !_backend.isStreamRunning())
-            open_device(device_info(default_device_id));
-    }
-    else
-    {
-        // If the stream stopped running (because the device was removed), check if the device has come back, and if so restart the stream.
-        if (current_device_is_valid())
-            return;
+    AUDIO_TRACE_SCOPE("InputStream::update");
+    // Fast path, taken almost every frame: a single atomic load, no device probing.
+    // If the device was removed or has come back, the registry will have a new generation.
+    // We also check every few seconds, in case the stream has failed to open or has been stopped by the backend.
+    auto const devices_generation = devices_registry().generation();
+    if (devices_generation == _devices_generation && !_controller.is_time_for_periodic_check())
+        return;
+    _devices_generation = devices_generation;
 
-        auto const id = find_device_id_by_name(std::get<UseGivenDevice>(_selected_device).name);
-        if (id == 0)
-            return;
+    auto const  devices = devices_registry().snapshot();
+    auto const* device  = devices->find_device(_selected_device, devices->default_input_device_id);
+    if (!device) // The device has been removed, we will check again when it comes back (i.e. when the registry changes) or at the next periodic check.
+        return;
 
-        open_device(device_info(id));
-    }
+    request_open_device(*device);
 }
 
 auto InputStream::current_device_is_valid() const -> bool
 {
-    return _backend.isStreamRunning();
+    return _controller.state() == StreamState::Running;
 }
 
 auto InputStream::find_device_id_by_name(std::string const& name) const -> unsigned int
@@ -49,140 +51,186 @@ auto InputStream::find_device_id_by_name(std::string const& name) const -> unsig
 
 auto InputStream::find_device_info_by_name(std::string const& name) const -> RtAudio::DeviceInfo
 {
-    auto const ids = device_ids();
-    for (auto const id : ids)
-    {
-        auto const info = device_info(id);
-        if (info.name == name)
-            return info;
-    }
-    return {};
+    auto const  devices = devices_registry().snapshot();
+    auto const* info    = devices->find_device(name);
+    return info ? *info : RtAudio::DeviceInfo{};
 }
 
 auto InputStream::device_ids() const -> std::vector<unsigned int>
 {
-    auto ids = _backend.getDeviceIds();
-    // Keep only the input devices
-    std::erase_if(ids, [&](unsigned int id) {
-        auto const info = _backend.getDeviceInfo(id);
-        return info.inputChannels == 0;
-    });
+    auto const devices = devices_registry().snapshot();
+    auto       ids     = std::vector<unsigned int>{};
+    for (auto const& info : devices->devices)
+    {
+        if (info.inputChannels != 0) // Keep only the input devices
+            ids.push_back(info.ID);
+    }
     return ids;
 }
 
 auto InputStream::default_device_id() const -> unsigned int
 {
-    return _backend.getDefaultInputDevice();
+    return devices_registry().snapshot()->default_input_device_id;
 }
 
 auto InputStream::device_info(unsigned int device_id) const -> RtAudio::DeviceInfo
 {
-    return _backend.getDeviceInfo(device_id);
+    auto const  devices = devices_registry().snapshot();
+    auto const* info    = devices->find_device(device_id);
+    return info ? *info : RtAudio::DeviceInfo{};
 }
 
-void InputStream::shrink_samples_to_fit()
+void InputStream::set_nb_of_retained_samples(size_t samples_count)
 {
-    while (_samples.size() > _nb_of_retained_samples && !_samples.empty())
-        _samples.pop_front();
+    _controller.post([this, samples_count](RtAudio& backend) {
+        _nb_of_retained_samples = samples_count;
+        if (2 * (_nb_of_retained_samples + _nb_frames_per_callback) <= _samples.capacity())
+            return;
+
+        // The buffer needs to grow. We can't do it while the audio thread is writing to it, so we pause the stream (this only happens when the max number of samples increases).
+        bool const was_running = backend.isStreamRunning();
+        if (was_running)
+            backend.stopStream();
+        reset_samples(_samples.channels_count());
+        if (was_running)
+            backend.startStream();
+    });
 }
 
-void InputStream::set_nb_of_retained_samples(size_t samples_count)
+void InputStream::set_channels_count(unsigned int channels_count)
 {
-    _nb_of_retained_samples = samples_count;
-    // shrink_samples_to_fit(); // Don't shrink here, this will be done during `for_each_sample()`. This avoids locking too often.
+    _controller.post([this, channels_count](RtAudio&) {
+        _requested_channels_count = std::max(channels_count, 1u);
+        _opened_device_name.clear(); // Force the stream to be reopened with the new number of channels.
+    });
+    _devices_generation = 0; // Make sure the next update() reopens the stream.
 }
 
-void InputStream::for_each_sample(int64_t samples_count, std::function<void(float)> const& callback)
+auto InputStream::channels_count() const -> unsigned int
 {
-    auto const samples = [&]() {
-        std::lock_guard const lock{_samples_mutex}; // Lock while we copy
-        shrink_samples_to_fit();                    // Might not be fit, if set_nb_of_retained_samples() has been called.
-        return _samples;
-    }();
-    for ( // Take the `samples_count` last elements of `samples`.
-        int64_t i = static_cast<int64_t>(samples.size()) - samples_count;
-        i < static_cast<int64_t>(samples.size());
-        ++i
-    )
-    {
-        if (i < 0) // If `samples` has less than `samples_count` elements this will happen.
-            callback(0.f);
-        else
-            callback(samples[static_cast<size_t>(i)]);
-    }
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_samples_reset_mutex};
+    return _samples.channels_count();
 }
 
-auto audio_input_callback(void* /* output_buffer */, void* input_buffer, unsigned int frames_count, double /* stream_time */, RtAudioStreamStatus /* status */, void* user_data) -> int
+auto InputStream::read_samples(std::span<float> destination, unsigned int channel_index) const -> bool
 {
-    auto const input = std::span{static_cast<float*>(input_buffer), frames_count};
-    auto&      This  = *static_cast<InputStream*>(user_data);
+    AUDIO_ASSERT_NOT_REALTIME();
+    AUDIO_TRACE_SCOPE("InputStream::read_samples");
+    std::lock_guard const lock{_samples_reset_mutex};
+    return _samples.read_latest(destination, channel_index);
+}
 
-    {
-        std::lock_guard const lock{This._samples_mutex};
-        for (float const sample : input)
+void InputStream::for_each_sample(int64_t samples_count, std::function<void(float)> const& callback)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    AUDIO_TRACE_SCOPE("InputStream::for_each_sample");
+    auto const mono = [&]() {
+        std::lock_guard const lock{_samples_reset_mutex}; // Lock while we copy
+        auto const            channels = _samples.channels_count();
+        auto                  mono     = std::vector<float>(static_cast<size_t>(std::max(samples_count, int64_t{0})), 0.f);
+        auto                  channel  = std::vector<float>(mono.size());
+        for (unsigned int channel_index = 0; channel_index < channels; ++channel_index)
         {
-            This._samples.push_back(sample);
-            This.shrink_samples_to_fit();
+            _samples.read_latest(channel, channel_index); // If it fails, the channel is silent for this read.
+            for (size_t i = 0; i < mono.size(); ++i)
+                mono[i] += channel[i] / static_cast<float>(channels);
         }
-    }
+        return mono;
+    }();
+    for (float const sample : mono)
+        callback(sample);
+}
+
+auto audio_input_callback(void* /* output_buffer */, void* input_buffer, unsigned int frames_count, double /* stream_time */, RtAudioStreamStatus /* status */, void* user_data) -> int
+{
+    AUDIO_TRACE_SCOPE("InputStream callback");
+    AUDIO_REALTIME_SCOPE();
+    auto& This = *static_cast<InputStream*>(user_data);
+    This._samples.push_interleaved(static_cast<float const*>(input_buffer), frames_count); // Lock-free, the audio thread never waits for the main thread.
+    This._recorder.push_interleaved(static_cast<float const*>(input_buffer), frames_count, This._samples.channels_count()); // Lock-free too, the file is written by another thread.
     return 0;
 }
 
+void InputStream::start_recording(std::filesystem::path const& path, RecordingFormat format)
+{
+    if (stream_state() != StreamState::Running)
+        throw std::runtime_error{"Can't start recording: the input stream is not running."};
+    _recorder.start(path, format, channels_count(), sample_rate());
+}
+
 void InputStream::use_given_device(RtAudio::DeviceInfo const& info)
 {
-    _selected_device = UseGivenDevice{info.name};
-    if (_backend.isStreamOpen())
-        open_device(info);
+    use_device(UseGivenDevice{info.name});
 }
 
 void InputStream::use_default_device()
 {
-    _selected_device = UseDefaultDevice{};
-    if (_backend.isStreamOpen())
-        open_device(device_info(_backend.getDefaultInputDevice()));
+    use_device(UseDefaultDevice{});
 }
 
 void InputStream::use_device(SelectedDevice device)
 {
-    _selected_device = std::move(device);
-    if (_backend.isStreamOpen())
-        open_selected_device();
+    _selected_device    = std::move(device);
+    _devices_generation = 0; // Make sure the next update() switches to the new device.
+}
+
+void InputStream::reset_samples(unsigned int channels_count)
+{
+    std::lock_guard const lock{_samples_reset_mutex};
+    // Leave enough room so that the audio thread can push a few callbacks worth of samples while we are reading the ones we need.
+    _samples.reset(channels_count, 2 * (_nb_of_retained_samples + _nb_frames_per_callback));
 }
 
-void InputStream::open_selected_device()
+void InputStream::request_open_device(RtAudio::DeviceInfo const& info)
 {
-    if (std::holds_alternative<UseDefaultDevice>(_selected_device))
-        open_device(device_info(_backend.getDefaultInputDevice()));
-    else
-        open_device(find_device_info_by_name(std::get<UseGivenDevice>(_selected_device).name));
+    _controller.open(
+        [this, name = info.name](RtAudio& backend) { // Already using this device, nothing to do.
+            return backend.isStreamRunning() && name == _opened_device_name;
+        },
+        [this, info](RtAudio& backend) {
+            return open_device(backend, info);
+        }
+    );
 }
 
-void InputStream::open_device(RtAudio::DeviceInfo const& info)
+auto InputStream::open_device(RtAudio& backend, RtAudio::DeviceInfo const& info) -> bool
 {
-    close(); // Close the current stream if there was one. We want to reopen one with the new device.
+    if (backend.isStreamOpen())
+        backend.closeStream(); // Close the current stream if there was one. We want to reopen one with the new device.
+    _opened_device_name.clear();
 
-    { // Clear the samples, they do not correspond to the new device. (Shouldn't really matter, but I guess this is technically more correct)
-        std::lock_guard const lock{_samples_mutex};
-        _samples.clear();
-    }
+    auto const device_id = backend_device_id(backend, info.name);
+    if (device_id == 0)
+        return false;
 
     RtAudio::StreamParameters params;
-    params.deviceId  = info.ID;
-    params.nChannels = 1;
+    params.deviceId  = device_id;
+    params.nChannels = std::clamp(_requested_channels_count, 1u, std::max(info.inputChannels, 1u));
     unsigned int nb_frames{512};                         // 512 is a decent value that seems to work well.
     auto const   sample_rate = info.preferredSampleRate; // TODO(Audio) Should we use preferredSampleRate or currentSampleRate?
-    _backend.openStream(nullptr, &params, RTAUDIO_FLOAT32, sample_rate, &nb_frames, &audio_input_callback, this);
-    _backend.startStream();
+    if (backend.openStream(nullptr, &params, RTAUDIO_FLOAT32, sample_rate, &nb_frames, &audio_input_callback, this) != RTAUDIO_NO_ERROR)
+        return false;
+
+    // The stream is open but not started yet, so the audio thread can't be using the samples.
+    // Clear them, they do not correspond to the new device, and adapt them to the actual number of channels and frames per callback.
+    _nb_frames_per_callback = nb_frames;
+    reset_samples(params.nChannels);
+    if (backend.startStream() != RTAUDIO_NO_ERROR)
+    {
+        backend.closeStream();
+        return false;
+    }
 
-    _current_input_device_sample_rate = sample_rate;
-    _current_device_id                = info.ID;
+    _current_input_device_sample_rate.store(sample_rate, std::memory_order_release);
+    _opened_device_name = info.name;
+    return true;
 }
 
 void InputStream::close()
 {
-    if (_backend.isStreamOpen())
-        _backend.closeStream();
-    _current_device_id = 0;
+    _controller.close();
+    _devices_generation = 0; // Like before the stream was first opened: the next update() will open it again.
 }
 
 } // namespace Audio
\ No newline at end of file
@@ -1,17 +1,16 @@
 #pragma once
-#include <deque>
+#include <functional>
 #include <mutex>
+#include <span>
 #include <variant>
+#include "DevicesRegistry.hpp"
+#include "Recorder.hpp"
+#include "RingBuffer.hpp"
+#include "StreamController.hpp"
 #include "rtaudio/RtAudio.h"
 
 namespace Audio {
 
-struct UseDefaultDevice {};
-struct UseGivenDevice {
-    std::string name;
-};
-using SelectedDevice = std::variant<UseDefaultDevice, UseGivenDevice>;
-
 class InputStream {
 public:
     explicit InputStream(RtAudioErrorCallback);
@@ -22,16 +21,30 @@ public:
     auto operator=(InputStream&&) noexcept -> InputStream& = delete; //
 
     /// Must be called every frame.
+    /// It is cheap unless the devices have changed (see `devices_registry()`), in which case it asks the control thread to reopen the stream.
+    /// It never blocks: opening the stream happens in the background, see `stream_state()`.
     void update();
 
     /// Calls the callback for each of the `samples_count` latest samples received through the device.
-    /// This data is always mono-channel, 1 sample == 1 frame.
+    /// This data is always mono-channel, 1 sample == 1 frame: if the stream has several channels, they are averaged.
     void for_each_sample(int64_t samples_count, std::function<void(float)> const& callback);
-    /// You MUST call this function at least once at the beginning to tell us the maximum numbers of samples you will query with `for_each_sample`.
+    /// Copies the `destination.size()` latest samples received on the given channel into `destination` (the most recent sample being the last one).
+    /// If less samples than that have been received, the beginning of `destination` is filled with 0s.
+    /// `channel_index` MUST be smaller than `channels_count()`.
+    /// Returns false (and fills `destination` with 0s) if the samples couldn't be read consistently, e.g. because you asked for more samples than what you told `set_nb_of_retained_samples()`.
+    auto read_samples(std::span<float> destination, unsigned int channel_index) const -> bool;
+    /// You MUST call this function at least once at the beginning to tell us the maximum numbers of samples you will query with `for_each_sample` or `read_samples`.
     /// If that max number changes over time, you can call this function again to update it.
     void set_nb_of_retained_samples(size_t samples_count);
 
+    /// Sets the number of channels we capture from the device. Defaults to 1.
+    /// If the device has less channels than that, we will use all the channels of the device.
+    void set_channels_count(unsigned int channels_count);
+    /// The number of channels of the current stream (see `set_channels_count()`).
+    auto channels_count() const -> unsigned int;
+
     /// Returns the list of all the ids of input devices.
+    /// This, and all the other device queries, are cheap: they read the list cached by `devices_registry()` and never probe the OS.
     auto device_ids() const -> std::vector<unsigned int>;
     ///
     auto default_device_id() const -> unsigned int;
@@ -43,7 +56,7 @@ public:
     ///
     auto current_device() const -> SelectedDevice const& { return _selected_device; }
     /// Returns the sample rate of the currently used device.
-    auto sample_rate() const -> unsigned int { return _current_input_device_sample_rate; }
+    auto sample_rate() const -> unsigned int { return _current_input_device_sample_rate.load(std::memory_order_acquire); }
     /// Sets the device to use.
     /// By default, when an InputStream is created it uses the default input device selected by the OS.
     void use_given_device(RtAudio::DeviceInfo const& info);
@@ -55,27 +68,50 @@ public:
     void use_device(SelectedDevice);
     ///
     auto current_device_is_valid() const -> bool;
+    /// Tells you if the stream is being opened, is running, has failed to open, etc.
+    /// All of that happens on a control thread, so that the main thread is never blocked.
+    auto stream_state() const -> StreamState { return _controller.state(); }
+    /// Starts writing all the samples we receive into the given file, until stop_recording() is called (see `Recorder`).
+    /// The stream MUST be running (see `stream_state()`), because the file uses its number of channels and its sample rate.
+    /// Throws an exception if the file can't be created or the stream is not running.
+    void start_recording(std::filesystem::path const&, RecordingFormat = RecordingFormat::Wav);
+    /// Finishes writing the file. Does nothing if we were not recording.
+    void stop_recording() { _recorder.stop(); }
+    /// Tells you if we are recording, and how many samples have been written and dropped.
+    auto recorder() const -> Recorder const& { return _recorder; }
     /// Closes the current stream, disconnects from the current device.
     /// Does nothing if the stream was not open / no device was set.
+    /// NB: this happens asynchronously, on the control thread.
     void close();
 
 private:
     friend auto audio_input_callback(void* output_buffer, void* input_buffer, unsigned int frames_count, double stream_time, RtAudioStreamStatus status, void* user_data) -> int;
 
-    void open_device(RtAudio::DeviceInfo const& info);
-    void open_selected_device();
-    /// /!\ YOU MUST LOCK `_samples_mutex` before using this function
-    void shrink_samples_to_fit();
+    /// Asks the control thread to (re)open the stream with the given device.
+    void request_open_device(RtAudio::DeviceInfo const& info);
+    /// /!\ Must only be called on the control thread.
+    auto open_device(RtAudio&, RtAudio::DeviceInfo const& info) -> bool;
+    /// Makes sure `_samples` is big enough for `_nb_of_retained_samples` and `_nb_frames_per_callback`.
+    /// /!\ Must only be called on the control thread, and the stream MUST NOT be running.
+    void reset_samples(unsigned int channels_count);
 
 private:
-    std::deque<float> _samples{};
-    size_t            _nb_of_retained_samples{256};
-    std::mutex        _samples_mutex{};
+    RingBuffer         _samples{};
+    mutable std::mutex _samples_reset_mutex{}; // Protects `_samples` from being resized by the control thread while the main thread reads it. The audio thread never takes it.
+    Recorder           _recorder{};
+
+    // Only used on the control thread
+    size_t       _nb_of_retained_samples{256};
+    unsigned int _requested_channels_count{1};
+    unsigned int _nb_frames_per_callback{512}; // 512 is a decent value that seems to work well.
+    std::string  _opened_device_name{};
+
+    // Only used on the main thread
+    SelectedDevice _selected_device{UseDefaultDevice{}};
+    uint64_t       _devices_generation{0}; // Generation of the devices registry last time we checked our device.
 
-    mutable RtAudio _backend{};
-    SelectedDevice  _selected_device{UseDefaultDevice{}};
-    unsigned int    _current_input_device_sample_rate{};
-    unsigned int    _current_device_id{};
+    std::atomic<unsigned int> _current_input_device_sample_rate{};
+    StreamController          _controller; // Must be declared last, so that its thread is stopped before the other members are destroyed.
 };
 
 } // namespace Audio
\ No newline at end of file
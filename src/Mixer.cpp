@@ -0,0 +1,224 @@
+#include "Mixer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <span>
+#include <thread>
+#include "DevicesRegistry.hpp"
+#include "Player.hpp"
+#include "Tracer.hpp"
+
+namespace Audio {
+
+static constexpr unsigned int output_channels_count = 2;
+
+// Can be changed at any time by set_error_callback(), while the control thread of the mixer might be reporting an error.
+static auto error_callback_mutex() -> std::mutex&
+{
+    static std::mutex instance{};
+    return instance;
+}
+
+static auto error_callback() -> RtAudioErrorCallback&
+{
+    static RtAudioErrorCallback instance{};
+    return instance;
+}
+
+/// Forwards to the latest callback given to set_error_callback(), even if it was set after the mixer has been created.
+static void report_error(RtAudioErrorType type, std::string const& message)
+{
+    auto const callback = []() {
+        std::lock_guard const lock{error_callback_mutex()};
+        return error_callback();
+    }();
+    if (callback)
+        callback(type, message);
+}
+
+Mixer::Mixer()
+    : _controller{&report_error}
+{
+    update_device_if_necessary();
+}
+
+void Mixer::add(Player& player)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_sources_mutex};
+    _sources.push_back(&player);
+    publish_sources();
+}
+
+void Mixer::remove(Player& player)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::lock_guard const lock{_sources_mutex};
+    std::erase(_sources, &player);
+    publish_sources(); // Once this returns, the audio thread can't be using `player` anymore, so it can safely be destroyed.
+}
+
+void Mixer::publish_sources()
+{
+    auto new_sources = std::make_unique<std::vector<Player*> const>(_sources);
+    _sources_for_audio_thread.store(new_sources.get(), std::memory_order_seq_cst);
+
+    // If a callback has started before we published the new list, it might still be using the old one: wait for it to finish.
+    // Callbacks that start after this point will see the new list.
+    auto const counter = _rendering_counter.load(std::memory_order_seq_cst);
+    if (counter % 2 == 1)
+    {
+        while (_rendering_counter.load(std::memory_order_seq_cst) == counter)
+            std::this_thread::yield();
+    }
+
+    _published_sources = std::move(new_sources); // Destroys the old list, nobody uses it anymore.
+}
+
+void Mixer::update_device_if_necessary()
+{
+    // Fast path, taken almost every frame: the default device can only have changed if the registry has a new generation.
+    // We also check every few seconds, in case the stream has failed to open or has been stopped by the backend.
+    auto const devices_generation = devices_registry().generation();
+    if (devices_generation == _devices_generation && !_controller.is_time_for_periodic_check())
+        return;
+    _devices_generation = devices_generation;
+
+    _controller.open(
+        [this](RtAudio& backend) { // The current stream is still adapted, nothing to do.
+            return backend.isStreamRunning() && backend.getDefaultOutputDevice() == _current_output_device_id;
+        },
+        [this](RtAudio& backend) {
+            return recreate_stream(backend, backend.getDefaultOutputDevice());
+        }
+    );
+}
+
+auto Mixer::audible_time_of_current_buffer(double stream_time) -> std::chrono::steady_clock::time_point
+{
+    // The callbacks are not called at perfectly regular intervals, because of the OS scheduler.
+    // But `stream_time` advances exactly with the samples consumed by the device, so we use it to predict when this callback should have been called,
+    // and only slowly correct that prediction with the actual time, which filters the jitter out.
+    static constexpr double correction_strength = 0.05;
+
+    auto const now = std::chrono::steady_clock::now();
+    auto const dt  = stream_time - _previous_stream_time;
+    if (_previous_stream_time < 0. || dt < 0. || dt > 1.) // First callback, or discontinuity (e.g. the stream was restarted)
+    {
+        _smoothed_callback_time = now;
+    }
+    else
+    {
+        auto const predicted    = _smoothed_callback_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{dt});
+        _smoothed_callback_time = predicted + std::chrono::duration_cast<std::chrono::steady_clock::duration>(correction_strength * (now - predicted));
+    }
+    _previous_stream_time = stream_time;
+
+    return _smoothed_callback_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{_output_latency_in_seconds.load(std::memory_order_relaxed)});
+}
+
+auto mixer_callback(void* output_buffer, void* /* input_buffer */, unsigned int frames_count, double stream_time, RtAudioStreamStatus /* status */, void* user_data) -> int
+{
+    AUDIO_TRACE_SCOPE("Mixer callback");
+    AUDIO_REALTIME_SCOPE();
+    auto& mixer  = *static_cast<Mixer*>(user_data);
+    auto  output = std::span{static_cast<float*>(output_buffer), static_cast<size_t>(frames_count) * output_channels_count};
+    std::fill(output.begin(), output.end(), 0.f);
+
+    mixer._rendering_counter.fetch_add(1, std::memory_order_seq_cst); // Now odd: we are rendering
+    auto const& sources        = *mixer._sources_for_audio_thread.load(std::memory_order_seq_cst);
+    auto const  sample_rate    = mixer._sample_rate.load(std::memory_order_relaxed);
+    auto const  audible_at     = mixer.audible_time_of_current_buffer(stream_time);
+    auto const  frame_duration = std::chrono::duration<double>{sample_rate != 0 ? 1. / static_cast<double>(sample_rate) : 0.};
+
+    for (Player* source : sources)
+    {
+        if (!source->is_active()) // Inactive sources cost nothing
+            continue;
+        float const volume = source->properties().is_muted ? 0.f : source->properties().volume; // A muted source is still rendered, so that its time keeps advancing.
+
+        // Render the source block by block in its own buffer, and add it to the output.
+        for (size_t offset = 0; offset < output.size(); offset += mixer._source_buffer.size())
+        {
+            auto const block = std::span{mixer._source_buffer}.first(std::min(mixer._source_buffer.size(), output.size() - offset));
+            auto const block_audible_at = audible_at + std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame_duration * static_cast<double>(offset / output_channels_count));
+            source->render(block, sample_rate, block_audible_at);
+            for (size_t i = 0; i < block.size(); ++i) // Simple enough to be vectorized by the compiler
+                output[offset + i] += volume * block[i];
+        }
+    }
+
+    mixer._rendering_counter.fetch_add(1, std::memory_order_seq_cst); // Now even: we are done
+    return 0;
+}
+
+auto Mixer::recreate_stream(RtAudio& backend, unsigned int device_id) -> bool
+{
+    if (backend.isStreamOpen())
+        backend.closeStream();
+    _current_output_device_id = device_id;
+    _sample_rate.store(0, std::memory_order_release);
+
+    if (device_id == 0) // No device
+        return true;
+
+    auto const sample_rate = backend.getDeviceInfo(device_id).preferredSampleRate;
+
+    RtAudio::StreamParameters _parameters;
+    _parameters.deviceId     = device_id;
+    _parameters.firstChannel = 0;
+    _parameters.nChannels    = output_channels_count;
+    unsigned int nb_frames_per_callback{128};
+
+    if (backend.openStream(
+            &_parameters,
+            nullptr, // No input stream needed
+            RTAUDIO_FLOAT32,
+            sample_rate,
+            &nb_frames_per_callback,
+            &mixer_callback,
+            this
+        )
+        != RTAUDIO_NO_ERROR)
+    {
+        return false;
+    }
+
+    // The stream is not started yet, so the audio thread can't be using them.
+    _source_buffer.assign(static_cast<size_t>(std::max(nb_frames_per_callback, 1u)) * output_channels_count, 0.f);
+    _previous_stream_time = -1.;
+    _sample_rate.store(sample_rate, std::memory_order_release);
+
+    auto const latency_in_frames = backend.getStreamLatency(); // Not all APIs can report it, in which case we assume it's at least the size of our buffer.
+    _output_latency_in_seconds.store(
+        static_cast<double>(latency_in_frames > 0 ? static_cast<unsigned long>(latency_in_frames) : nb_frames_per_callback) / static_cast<double>(sample_rate),
+        std::memory_order_release
+    );
+    return backend.startStream() == RTAUDIO_NO_ERROR;
+}
+
+void Mixer::shut_down()
+{
+    _controller.close();
+    _controller.wait_until_idle();
+}
+
+void set_error_callback(RtAudioErrorCallback callback)
+{
+    devices_registry().set_error_callback(callback);
+    std::lock_guard const lock{error_callback_mutex()};
+    error_callback() = std::move(callback);
+}
+
+auto mixer() -> Mixer&
+{
+    static Mixer instance{};
+    return instance;
+}
+
+void shut_down()
+{
+    mixer().shut_down();
+}
+
+} // namespace Audio
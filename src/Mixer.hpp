@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "StreamController.hpp"
+#include "rtaudio/RtAudio.h"
+
+namespace Audio {
+
+class Player;
+
+/// Owns the one and only output stream, and mixes all the Players (its sources) into it.
+/// Each Player registers itself when it is created, so you never need to call `add()` and `remove()` yourself.
+///
+/// The stream uses the preferred sample rate of the default output device, and each source is resampled on the fly if its audio data uses a different one.
+/// /!\ IN ORDER FOR THIS TO WORK, you need to regularly call update_device_if_necessary() (or the one of any Player)
+/// so that we can check if the default device has changed and react accordingly.
+class Mixer {
+public:
+    Mixer();
+    ~Mixer()                                   = default;
+    Mixer(Mixer const&)                        = delete; // Can't copy nor move
+    auto operator=(Mixer const&) -> Mixer&     = delete; // because we pass the address of this object to the audio callback.
+    Mixer(Mixer&&) noexcept                    = delete; // And you should be using the global instance returned by
+    auto operator=(Mixer&&) noexcept -> Mixer& = delete; // Audio::mixer() anyways.
+
+    /// The audio thread never waits for these two functions.
+    /// But they might wait for the audio thread to finish the buffer it is currently rendering (i.e. a few milliseconds at most), to make sure it doesn't use the old list of sources anymore.
+    void add(Player&);
+    void remove(Player&);
+
+    /// Checks if the default device has changed (e.g. the user has just plugged in some headphones)
+    /// and switches device accordingly.
+    /// This is cheap: the devices are only probed again when `devices_registry()` has detected a change, and the stream is recreated on a control thread.
+    void update_device_if_necessary();
+    /// The sample rate of the output stream, or 0 if there is no stream.
+    [[nodiscard]] auto sample_rate() const -> unsigned int { return _sample_rate.load(std::memory_order_acquire); }
+    /// The time it takes for a sample given to the output stream to actually come out of the speakers, as reported by the device.
+    [[nodiscard]] auto output_latency_in_seconds() const -> double { return _output_latency_in_seconds.load(std::memory_order_acquire); }
+    /// Tells you if the stream is being opened, is running, has failed to open, etc.
+    [[nodiscard]] auto stream_state() const -> StreamState { return _controller.state(); }
+    /// Closes the stream and blocks until it is done.
+    void shut_down();
+
+private:
+    friend auto mixer_callback(void* output_buffer, void* input_buffer, unsigned int frames_count, double stream_time, RtAudioStreamStatus status, void* user_data) -> int;
+
+    /// Gives the new list of sources to the audio thread, and waits until it doesn't use the old one anymore.
+    void publish_sources();
+    /// Called at the beginning of each callback. Returns the moment where the first frame of the buffer will come out of the speakers.
+    auto audible_time_of_current_buffer(double stream_time) -> std::chrono::steady_clock::time_point;
+    /// /!\ Must only be called on the control thread.
+    auto recreate_stream(RtAudio&, unsigned int device_id) -> bool;
+
+private:
+    // Sources
+    std::vector<Player*>                        _sources{}; // The list that `add()` and `remove()` modify.
+    std::mutex                                  _sources_mutex{};
+    std::unique_ptr<std::vector<Player*> const> _published_sources{std::make_unique<std::vector<Player*> const>()};
+    std::atomic<std::vector<Player*> const*>    _sources_for_audio_thread{_published_sources.get()};
+    std::atomic<uint64_t>                       _rendering_counter{0}; // Incremented at the beginning and at the end of each callback, so it is odd iff the audio thread is rendering.
+
+    // Only used on the audio thread (and on the control thread while the stream is stopped)
+    std::vector<float>                    _source_buffer{};
+    double                                _previous_stream_time{-1.}; // -1 means that the stream has just been (re)created.
+    std::chrono::steady_clock::time_point _smoothed_callback_time{};  // The moment where the callback was called, minus the jitter of the OS scheduler.
+
+    // Output device
+    std::atomic<unsigned int> _sample_rate{0};
+    std::atomic<double>       _output_latency_in_seconds{0.};
+    unsigned int              _current_output_device_id{0}; // 0 is an invalid ID. Only used on the control thread.
+    uint64_t                  _devices_generation{0};       // Generation of the devices registry last time we checked the default device. Only used on the main thread.
+
+    StreamController _controller; // Must be declared last, so that its thread is stopped before the other members are destroyed.
+};
+
+/// Must be called before any call to mixer() or player() if you want to be sure to catch all errors.
+/// NB: the errors are reported on the thread that controls the stream, not on the main thread.
+void set_error_callback(RtAudioErrorCallback);
+/// Global instance that owns the output stream.
+auto mixer() -> Mixer&;
+/// Call this before your application exits.
+void shut_down();
+
+} // namespace Audio
@@ -0,0 +1,44 @@
+#include "PlaybackClock.hpp"
+#include <algorithm>
+
+namespace Audio {
+
+void PlaybackClock::set_anchor(double time_in_seconds, std::chrono::steady_clock::time_point audible_at, uint64_t transport_generation)
+{
+    auto const sequence = _sequence.load(std::memory_order_relaxed);
+    _sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _time_in_seconds.store(time_in_seconds, std::memory_order_relaxed);
+    _audible_at.store(audible_at.time_since_epoch().count(), std::memory_order_relaxed);
+    _transport_generation.store(transport_generation, std::memory_order_relaxed);
+    _sequence.store(sequence + 2, std::memory_order_release);
+}
+
+auto PlaybackClock::time_at(std::chrono::steady_clock::time_point now, uint64_t transport_generation, std::chrono::steady_clock::duration max_extrapolation) const -> std::optional<double>
+{
+    uint64_t sequence{};
+    double   time_in_seconds{};
+    int64_t  audible_at{};
+    uint64_t anchor_transport_generation{};
+    while (true)
+    {
+        sequence = _sequence.load(std::memory_order_acquire);
+        if (sequence % 2 == 1) // The audio thread is writing
+            continue;
+        time_in_seconds             = _time_in_seconds.load(std::memory_order_relaxed);
+        audible_at                  = _audible_at.load(std::memory_order_relaxed);
+        anchor_transport_generation = _transport_generation.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_sequence.load(std::memory_order_relaxed) == sequence)
+            break;
+    }
+
+    if (sequence == 0 // No anchor has been set yet
+        || anchor_transport_generation != transport_generation)
+        return std::nullopt;
+
+    auto const elapsed = std::min(now - std::chrono::steady_clock::time_point{std::chrono::steady_clock::duration{audible_at}}, max_extrapolation);
+    return time_in_seconds + std::chrono::duration<double>{elapsed}.count();
+}
+
+} // namespace Audio
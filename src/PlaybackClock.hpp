@@ -0,0 +1,31 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace Audio {
+
+/// Lets the audio thread tell any other thread "the sound at time X of the audio data will come out of the speakers at this moment",
+/// so that they can compute where the playhead is right now, with a much finer resolution than one callback.
+/// Both sides are lock-free (it is a seqlock: readers retry in the rare case where they read while the audio thread is writing).
+class PlaybackClock {
+public:
+    /// Called by the audio thread, for each block it renders.
+    /// `time_in_seconds` is the time (in the audio data) of the first frame of the block, and `audible_at` is the moment where this frame will actually be heard.
+    /// `transport_generation` identifies the state of the transport (see `time_at()`).
+    void set_anchor(double time_in_seconds, std::chrono::steady_clock::time_point audible_at, uint64_t transport_generation);
+
+    /// Can be called from any thread. Extrapolates from the latest anchor the time that is being heard at the moment `now`.
+    /// Returns nothing if the latest anchor was set with a different `transport_generation` (e.g. because the user has seeked since then, and the audio thread hasn't rendered anything since).
+    /// To avoid running away if the audio thread stalls, we never extrapolate more than `max_extrapolation` past the latest anchor.
+    [[nodiscard]] auto time_at(std::chrono::steady_clock::time_point now, uint64_t transport_generation, std::chrono::steady_clock::duration max_extrapolation) const -> std::optional<double>;
+
+private:
+    std::atomic<uint64_t> _sequence{0}; // Odd while the audio thread is writing.
+    std::atomic<double>   _time_in_seconds{0.};
+    std::atomic<int64_t>  _audible_at{0}; // steady_clock ticks
+    std::atomic<uint64_t> _transport_generation{0};
+};
+
+} // namespace Audio
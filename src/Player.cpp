@@ -1,16 +1,12 @@
 #include "Player.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <utility>
+#include "Tracer.hpp"
 
 namespace Audio {
 
-static constexpr int64_t output_channels_count = 2;
-
-static auto backend() -> RtAudio&
-{
-    static RtAudio instance{};
-    return instance;
-}
-
 #ifndef NDEBUG // Only used by the assert, so unused in Release, which would cause a warning.
 static auto is_API_available() -> bool
 {
@@ -23,123 +19,184 @@ static auto is_API_available() -> bool
 Player::Player()
 {
     assert(is_API_available());
+    mixer().add(*this);
+}
+
+Player::~Player()
+{
+    mixer().remove(*this);
+}
+
+void Player::update()
+{
+    AUDIO_TRACE_SCOPE("Player::update");
     update_device_if_necessary();
+    if (!_pending_data.valid() || _pending_data.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+        return;
+
+    auto pending = std::exchange(_pending_data, {});
+    try
+    {
+        set_audio_data(pending.get());
+    }
+    catch (...)
+    {
+        // Keep the current data. The owner of the future can still get the error from it.
+    }
 }
 
 void Player::update_device_if_necessary()
 {
-    auto const id = backend().getDefaultOutputDevice();
-    if (id == _current_output_device_id)
-        return;
+    mixer().update_device_if_necessary();
+}
 
-    _current_output_device_id = id;
-    recreate_stream_adapted_to_current_audio_data();
+auto Player::stream_state() const -> StreamState
+{
+    return mixer().stream_state();
 }
 
 auto Player::has_audio_data() const -> bool
 {
-    return !_data.samples.empty();
+    return _data->samples_count() != 0;
 }
 
-auto Player::has_device() const -> bool
+auto Player::is_active() const -> bool
 {
-    return _current_output_device_id != 0;
+    return is_playing() && has_audio_data();
 }
 
-auto audio_callback(void* output_buffer, void* /* input_buffer */, unsigned int frames_count, double /* stream_time */, RtAudioStreamStatus /* status */, void* user_data) -> int
+void Player::render_resampled(std::span<float> interleaved_stereo_block, double& position, double step) const
 {
-    auto* out_buffer = static_cast<float*>(output_buffer);
-    auto& player     = *static_cast<Player*>(user_data);
-
-    for (int64_t frame_idx = 0; frame_idx < frames_count; frame_idx++)
+    // Linear interpolation between the two closest frames, so that audio data with any sample rate can be played on any device.
+    for (size_t i = 0; i + 1 < interleaved_stereo_block.size(); i += 2)
     {
-        for (int64_t channel_idx = 0; channel_idx < output_channels_count; ++channel_idx)
+        auto const frame = static_cast<int64_t>(std::floor(position));
+        auto const t     = static_cast<float>(position - static_cast<double>(frame));
+        for (size_t channel = 0; channel < 2; ++channel)
         {
-            out_buffer[frame_idx * output_channels_count + channel_idx] = // NOLINT(*pointer-arithmetic)
-                player._is_playing
-                    ? player.sample(player._next_frame_to_play, channel_idx)
-                    : 0.f;
+            auto const a                          = sample_unaltered_volume(frame, static_cast<int64_t>(channel));
+            auto const b                          = t == 0.f ? a : sample_unaltered_volume(frame + 1, static_cast<int64_t>(channel));
+            interleaved_stereo_block[i + channel] = a + t * (b - a);
         }
-        if (player._is_playing)
-            ++player._next_frame_to_play;
+        position += step;
     }
-
-    return 0;
 }
 
-void Player::recreate_stream_adapted_to_current_audio_data()
+void Player::render(std::span<float> interleaved_stereo_block, unsigned int output_sample_rate, std::chrono::steady_clock::time_point audible_at)
 {
-    if (backend().isStreamOpen())
-        backend().closeStream();
-
-    if (!has_audio_data()
-        || !has_device())
+    AUDIO_TRACE_SCOPE("Player::render");
+    // Never wait for the main thread: if it is currently swapping the audio data, output silence for this block.
+    std::unique_lock const lock{_data_mutex, std::try_to_lock};
+    if (!lock.owns_lock() || output_sample_rate == 0)
+    {
+        std::fill(interleaved_stereo_block.begin(), interleaved_stereo_block.end(), 0.f);
         return;
+    }
 
-    RtAudio::StreamParameters _parameters;
-    _parameters.deviceId     = _current_output_device_id;
-    _parameters.firstChannel = 0;
-    _parameters.nChannels    = output_channels_count;
-    unsigned int nb_frames_per_callback{128};
-
-    backend().openStream(
-        &_parameters,
-        nullptr, // No input stream needed
-        RTAUDIO_FLOAT32,
-        _data.sample_rate, // TODO(Audio) Resample the audio data to make it match the preferredSampleRate of the device. The current strategy works, unless the device does not support the sample_rate used by our audio data, in which case the audio will be played too slow or too fast.
-        &nb_frames_per_callback,
-        &audio_callback,
-        this
-    );
+    auto const transport_generation = _transport_generation.load(std::memory_order_acquire);
+    auto const step                 = static_cast<double>(_data->sample_rate) / static_cast<double>(output_sample_rate);
+    auto const start_position       = _position.load(std::memory_order_acquire);
+    auto       position             = start_position;
+    auto const frames_count         = interleaved_stereo_block.size() / 2;
+
+    auto const first_sample = static_cast<int64_t>(start_position) * 2;
+    if (step == 1.                                               // No resampling needed
+        && _data->channels_count == 2                            // The data is already interleaved stereo
+        && position == std::floor(position) && first_sample >= 0 // Not in between two frames
+        && first_sample + static_cast<int64_t>(interleaved_stereo_block.size()) <= static_cast<int64_t>(_data->samples_count()))
+    {
+        // Fast path: decode the whole block at once.
+        _data->read_samples(static_cast<size_t>(first_sample), interleaved_stereo_block);
+        position += static_cast<double>(frames_count);
+    }
+    else
+    {
+        render_resampled(interleaved_stereo_block, position, step);
+    }
 
-    backend().startStream();
+    // If the main thread has called set_time() in the meantime, keep its value instead of ours.
+    auto expected = start_position;
+    if (_position.compare_exchange_strong(expected, position, std::memory_order_acq_rel))
+        _clock.set_anchor(start_position / static_cast<double>(_data->sample_rate), audible_at, transport_generation);
 }
 
 void Player::set_audio_data(AudioData data)
 {
-    if (backend().isStreamOpen())
-        backend().closeStream(); // Otherwise data race with the audio thread that is reading _audio_data. Could cause crashes.
+    set_audio_data(std::make_shared<AudioData const>(std::move(data)));
+}
+
+void Player::set_audio_data(AudioDataFuture data)
+{
+    _pending_data = std::move(data);
+}
 
+void Player::set_audio_data(std::shared_ptr<AudioData const> data)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    AUDIO_TRACE_SCOPE("Player::set_audio_data");
     double const current_time = get_time();
+    _pending_data             = {};
+    if (!data)
+        data = std::make_shared<AudioData const>();
 
-    _data = std::move(data);
-    set_time(current_time); // Need to adjust the _next_frame_to_play so that we will be at the same point in time in both audios even if they have different sample rates.
-
-    recreate_stream_adapted_to_current_audio_data();
+    {
+        std::lock_guard const lock{_data_mutex}; // Otherwise data race with the audio thread that is reading _audio_data. Could cause crashes.
+        _data = std::move(data);
+        set_time(current_time); // Need to adjust the _position so that we will be at the same point in time in both audios even if they have different sample rates.
+    }
+    _transport_generation.fetch_add(1, std::memory_order_acq_rel);
 }
 
 void Player::reset_audio_data()
 {
-    set_audio_data({});
+    set_audio_data(AudioData{});
 }
 
 void Player::play()
 {
-    _is_playing = true;
+    if (!_is_playing.exchange(true, std::memory_order_acq_rel))
+        _transport_generation.fetch_add(1, std::memory_order_acq_rel);
 }
 
 void Player::pause()
 {
-    _is_playing = false;
+    if (_is_playing.exchange(false, std::memory_order_acq_rel))
+        _transport_generation.fetch_add(1, std::memory_order_acq_rel);
 }
 
 auto Player::set_time(double time_in_seconds) -> bool
 {
-    auto const next_frame_to_play = static_cast<int64_t>(
-        static_cast<double>(_data.sample_rate)
+    auto const position = std::trunc(
+        static_cast<double>(_data->sample_rate)
         * time_in_seconds
     );
-    bool const has_changed = next_frame_to_play != _next_frame_to_play;
-    _next_frame_to_play    = next_frame_to_play;
+    bool const has_changed = _position.exchange(position, std::memory_order_acq_rel) != position;
+    if (has_changed)
+        _transport_generation.fetch_add(1, std::memory_order_acq_rel);
     return has_changed;
 }
 
 auto Player::get_time() const -> double
 {
-    if (_data.sample_rate == 0)
+    if (_data->sample_rate == 0)
         return 0.;
-    return static_cast<double>(_next_frame_to_play)
-           / static_cast<double>(_data.sample_rate);
+    return _position.load(std::memory_order_acquire)
+           / static_cast<double>(_data->sample_rate);
+}
+
+auto Player::get_audible_time() const -> double
+{
+    if (!is_playing())
+        return get_time();
+
+    // Never extrapolate further than a few buffers, so that the time freezes instead of running away if the audio thread stalls.
+    static constexpr auto max_extrapolation = std::chrono::milliseconds{100};
+
+    auto const time = _clock.time_at(std::chrono::steady_clock::now(), _transport_generation.load(std::memory_order_acquire), max_extrapolation);
+    if (time)
+        return *time;
+    // The audio thread hasn't rendered anything since the last change: the next frame it renders is the one at `get_time()`, and it will only come out of the speakers after the latency of the device.
+    return get_time() - mixer().output_latency_in_seconds();
 }
 
 static auto mod(int64_t a, int64_t b) -> int64_t
@@ -162,38 +219,33 @@ auto Player::sample_unaltered_volume(int64_t frame_index, int64_t channel_index)
     if (!has_audio_data())
         return 0.f;
 
-    auto const sample_index = frame_index * _data.channels_count
-                              + channel_index % _data.channels_count;
+    auto const sample_index = frame_index * _data->channels_count
+                              + channel_index % _data->channels_count;
     if ((sample_index < 0
-         || sample_index >= static_cast<int64_t>(_data.samples.size())
+         || sample_index >= static_cast<int64_t>(_data->samples_count())
         )
         && !_properties.does_loop)
         return 0.f;
 
-    return _data.samples[static_cast<size_t>(mod(sample_index, static_cast<int64_t>(_data.samples.size())))];
+    return _data->sample(static_cast<size_t>(mod(sample_index, static_cast<int64_t>(_data->samples_count()))));
 }
 
 auto Player::sample(int64_t frame_index) const -> float
 {
     // The arithmetic mean is a good way of combining the values of the different channels, according to ChatGPT.
     float res{0.f};
-    for (unsigned int i = 0; i < _data.channels_count; ++i)
+    for (unsigned int i = 0; i < _data->channels_count; ++i)
         res += sample(frame_index, i);
-    return res / static_cast<float>(_data.channels_count);
+    return res / static_cast<float>(_data->channels_count);
 }
 
 auto Player::sample_unaltered_volume(int64_t frame_index) const -> float
 {
     // The arithmetic mean is a good way of combining the values of the different channels, according to ChatGPT.
     float res{0.f};
-    for (unsigned int i = 0; i < _data.channels_count; ++i)
+    for (unsigned int i = 0; i < _data->channels_count; ++i)
         res += sample_unaltered_volume(frame_index, i);
-    return res / static_cast<float>(_data.channels_count);
-}
-
-void set_error_callback(RtAudioErrorCallback callback)
-{
-    backend().setErrorCallback(std::move(callback));
+    return res / static_cast<float>(_data->channels_count);
 }
 
 auto player() -> Player&
@@ -202,10 +254,4 @@ auto player() -> Player&
     return instance;
 }
 
-void shut_down()
-{
-    if (backend().isStreamOpen())
-        backend().closeStream();
-}
-
 } // namespace Audio
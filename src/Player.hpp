@@ -1,26 +1,17 @@
 #pragma once
 #include <rtaudio/RtAudio.h>
+#include <atomic>
 #include <cstdint>
+#include <mutex>
+#include <span>
 #include <vector>
+#include "AudioData.hpp"
+#include "AudioLoader.hpp"
+#include "Mixer.hpp"
+#include "PlaybackClock.hpp"
 
 namespace Audio {
 
-struct AudioData {
-    /// All the samples. If `channels_count` is > 1, the data MUST be in interleaved format:
-    /// [Frame 0 | Channel 0]
-    /// [Frame 0 | Channel 1]
-    /// [Frame 1 | Channel 0]
-    /// [Frame 1 | Channel 1]
-    /// For a definition of Frame, see https://youtu.be/jNSiZqSQis4?t=937
-    std::vector<float> samples{};
-
-    /// The number of frames per second.
-    unsigned int sample_rate{};
-
-    /// The number of channels (usually 1 or 2, mono or stereo).
-    unsigned int channels_count{};
-};
-
 struct PlayerProperties {
     float volume{1.f};
     bool  is_muted{false};
@@ -33,24 +24,38 @@ struct PlayerProperties {
 /// (e.g. if they plug in headphones, they expect all the audio to come out of there
 /// and when they unplug them the audio should go back to the default speakers of their computer).
 ///
-/// /!\ IN ORDER FOR THIS TO WORK, you need to regularly call update_device_if_necessary()
-/// so that we can check if it has changed and react accordingly.
+/// Each Player is a source of the global `mixer()`, which owns the output stream.
+/// So you can create as many Players as you want (e.g. a music bed, some stems and a few one-shot cues), they will all be mixed together.
+///
+/// /!\ IN ORDER FOR THIS TO WORK, you need to regularly call update()
+/// so that we can check if the device has changed and react accordingly.
 class Player {
 public:
+    /// Registers the player in the `mixer()`.
     Player();
-    ~Player()                                    = default;
+    /// Unregisters the player from the `mixer()`.
+    ~Player();
     Player(Player const&)                        = delete; // Can't copy nor move
-    auto operator=(Player const&) -> Player&     = delete; // because we pass the address of this object to the audio callback.
-    Player(Player&&) noexcept                    = delete; // And you should be using the global instance returned by
-    auto operator=(Player&&) noexcept -> Player& = delete; // Audio::player() anyways.
+    auto operator=(Player const&) -> Player&     = delete; // because the mixer keeps the address of this object
+    Player(Player&&) noexcept                    = delete; // and uses it in the audio callback.
+    auto operator=(Player&&) noexcept -> Player& = delete; //
 
     /// Receives some data (e.g. a song coming from an mp3 file) and stores it.
     /// After that, the player is ready to play it whenever play() will be called (or starts playing immediately if play() has already been called).
     void set_audio_data(AudioData);
+    /// Same as above, but shares the data instead of copying it (e.g. with the cache of an `AudioLoader`).
+    void set_audio_data(std::shared_ptr<AudioData const>);
+    /// Queues some data that is still being loaded (see `AudioLoader::load()`).
+    /// The player keeps playing its current data until the new one is ready, and then switches to it during `update()`.
+    /// If the loading fails, the player keeps its current data (you can use your own copy of the future to get the error).
+    /// Any other call to set_audio_data() or reset_audio_data() cancels the queued data.
+    void set_audio_data(AudioDataFuture);
+    /// True iff some data has been queued with set_audio_data() and is still loading.
+    [[nodiscard]] auto is_loading_audio_data() const -> bool { return _pending_data.valid(); }
     /// Deletes the data that was set with set_audio_data().
     void reset_audio_data();
     /// Getter for the audio data.
-    [[nodiscard]] auto audio_data() const -> AudioData const& { return _data; }
+    [[nodiscard]] auto audio_data() const -> AudioData const& { return *_data; }
     /// True iff some data has been set with set_audio_data() and not reset with reset_audio_data().
     [[nodiscard]] auto has_audio_data() const -> bool;
 
@@ -64,7 +69,7 @@ public:
     /// Returns the value of the audio data at the given position in time, while ignoring the `volume` and `is_muted` properties of the player. It still takes `does_loop` into account.
     /// Does an average over all the samples for the given frame.
     [[nodiscard]] auto sample_unaltered_volume(int64_t frame_index) const -> float;
-    [[nodiscard]] auto current_frame_index() const -> int64_t { return _next_frame_to_play; }
+    [[nodiscard]] auto current_frame_index() const -> int64_t { return static_cast<int64_t>(_position.load(std::memory_order_acquire)); }
 
     /// Used to get and set the properties.
     [[nodiscard]] auto properties() -> PlayerProperties& { return _properties; }
@@ -76,44 +81,54 @@ public:
     /// Pauses the playing, or does nothing if it was already paused.
     void pause();
     ///
-    [[nodiscard]] auto is_playing() const -> bool { return _is_playing; }
+    [[nodiscard]] auto is_playing() const -> bool { return _is_playing.load(std::memory_order_acquire); }
     /// Makes the player jump to a specific moment in time.
     /// Return true iff the time has actually changed (i.e. the time that was passed to the function is different from the time that was currently set).
     auto set_time(double time_in_seconds) -> bool;
     /// Returns the moment in time the player is currently playing.
+    /// NB: It only advances once per audio callback, and doesn't take the latency of the device into account. To synchronize visuals with the audio, use `get_audible_time()` instead.
     [[nodiscard]] auto get_time() const -> double;
-
+    /// Returns the moment in time that is coming out of the speakers right now.
+    /// Unlike `get_time()`, it advances smoothly between two audio callbacks, and it compensates for the latency of the output device.
+    /// It is lock-free and can be called from any thread, as often as you want.
+    [[nodiscard]] auto get_audible_time() const -> double;
+
+    /// Must be called every frame.
+    /// Calls `update_device_if_necessary()`, and switches to the data queued with set_audio_data() once it has finished loading.
+    void update();
     /// Checks if the default device has changed (e.g. the user has just plugged in some headphones)
     /// and switches device accordingly.
-    /// You need to call this regularly (e.g. once per application frame), otherwise your application will not react to audio device changes.
+    /// This is the same as `mixer().update_device_if_necessary()`: the device is shared by all the players.
     void update_device_if_necessary();
+    /// Tells you if the output stream is being opened, is running, has failed to open, etc.
+    /// This is the same as `mixer().stream_state()`: the stream is shared by all the players.
+    [[nodiscard]] auto stream_state() const -> StreamState;
 
 private:
-    /// Destroys the current stream if there is one, and then creates a new one with a sample rate matching our audio data (or does not create anything if we have no audio data).
-    void recreate_stream_adapted_to_current_audio_data();
-
-    [[nodiscard]] auto has_device() const -> bool;
+    friend auto mixer_callback(void* output_buffer, void* input_buffer, unsigned int frames_count, double stream_time, RtAudioStreamStatus status, void* user_data) -> int;
 
-private:
-    friend auto audio_callback(void* output_buffer, void* input_buffer, unsigned int frames_count, double stream_time, RtAudioStreamStatus status, void* user_data) -> int;
+    /// True iff the player is moving forward in time, and must therefore be rendered (even if it is muted, it must keep advancing).
+    [[nodiscard]] auto is_active() const -> bool;
+    /// Called on the audio thread. Fills `interleaved_stereo_block` with the next frames of the audio data (without applying the volume), resampled to `output_sample_rate`, and advances the time.
+    /// `audible_at` is the moment where the first frame of the block will come out of the speakers.
+    void render(std::span<float> interleaved_stereo_block, unsigned int output_sample_rate, std::chrono::steady_clock::time_point audible_at);
+    /// Slow path of `render()`, used when the data needs to be resampled or converted to stereo.
+    void render_resampled(std::span<float> interleaved_stereo_block, double& position, double step) const;
 
 private:
-    AudioData        _data{};
-    PlayerProperties _properties{};
+    std::shared_ptr<AudioData const> _data{std::make_shared<AudioData const>()}; // Never null.
+    std::mutex                       _data_mutex{}; // Locked by the main thread while it modifies `_data`. The audio thread only ever try_lock()s it, so it never waits.
+    AudioDataFuture                  _pending_data{};
+    PlayerProperties                 _properties{};
 
     // Player state
-    int64_t _next_frame_to_play{0}; // Next frame of the `_data.samples` buffer that the player needs to play.
-    bool    _is_playing{false};
-
-    // Output device
-    unsigned int _current_output_device_id{0}; // 0 is an invalid ID.
+    std::atomic<double>   _position{0.}; // Position of the player in the `_data` buffer, in frames. Not an integer when the data is resampled.
+    std::atomic<bool>     _is_playing{false};
+    std::atomic<uint64_t> _transport_generation{1}; // Incremented each time the main thread changes the position or the playing state, so that `_clock` knows when its anchor is outdated.
+    PlaybackClock         _clock{};
 };
 
-/// Must be called before any call to player() if you want to be sure to catch all errors.
-void set_error_callback(RtAudioErrorCallback);
-/// Global instance that you need to use. Having two Players at once doesn't work anyways (because of the way rtaudio handles it I think).
+/// Global instance, for convenience. You can create other Players if you need to play several things at once, they will all be mixed together.
 auto player() -> Player&;
-/// Call this before your application exits.
-void shut_down();
 
-} // namespace Audio
\ No newline at end of file
+} // namespace Audio
@@ -0,0 +1,131 @@
+#include "Processor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace Audio {
+
+void Gain::process(std::span<float> interleaved_block, unsigned int channels_count)
+{
+    auto const target_gain  = _target_gain.load(std::memory_order_relaxed);
+    auto const frames_count = interleaved_block.size() / std::max(channels_count, 1u);
+    if (target_gain == _current_gain || frames_count == 0)
+    {
+        for (float& sample : interleaved_block) // Simple enough to be vectorized by the compiler
+            sample *= target_gain;
+        return;
+    }
+
+    // Linear ramp from the previous gain to the new one.
+    auto const step = (target_gain - _current_gain) / static_cast<float>(frames_count);
+    for (size_t frame = 0; frame < frames_count; ++frame)
+    {
+        auto const gain = _current_gain + step * static_cast<float>(frame + 1);
+        for (size_t channel = 0; channel < channels_count; ++channel)
+            interleaved_block[frame * channels_count + channel] *= gain;
+    }
+    _current_gain = target_gain;
+}
+
+BiquadFilter::BiquadFilter(BiquadSettings const& settings)
+    : _type{settings.type}
+    , _frequency_in_hz{settings.frequency_in_hz}
+    , _q{settings.q}
+    , _gain_in_db{settings.gain_in_db}
+{}
+
+void BiquadFilter::set_settings(BiquadSettings const& settings)
+{
+    _type.store(settings.type, std::memory_order_relaxed);
+    _frequency_in_hz.store(settings.frequency_in_hz, std::memory_order_relaxed);
+    _q.store(settings.q, std::memory_order_relaxed);
+    _gain_in_db.store(settings.gain_in_db, std::memory_order_relaxed);
+    _settings_version.fetch_add(1, std::memory_order_release); // If the audio thread reads the settings while we are writing them, it will see the new version on its next block and recompute them again.
+}
+
+auto BiquadFilter::settings() const -> BiquadSettings
+{
+    return {
+        .type            = _type.load(std::memory_order_relaxed),
+        .frequency_in_hz = _frequency_in_hz.load(std::memory_order_relaxed),
+        .q               = _q.load(std::memory_order_relaxed),
+        .gain_in_db      = _gain_in_db.load(std::memory_order_relaxed),
+    };
+}
+
+void BiquadFilter::prepare(StreamFormat const& format)
+{
+    _channels_states.assign(format.channels_count, {});
+    _sample_rate          = format.sample_rate;
+    _coefficients_version = 0; // The sample rate might have changed, so the coefficients need to be recomputed.
+}
+
+auto BiquadFilter::compute_coefficients(BiquadSettings const& settings, unsigned int sample_rate) -> Coefficients
+{
+    auto const nyquist   = static_cast<float>(sample_rate) / 2.f;
+    auto const w0        = 2.f * std::numbers::pi_v<float> * std::clamp(settings.frequency_in_hz, 1.f, 0.99f * nyquist) / static_cast<float>(sample_rate);
+    auto const cos_w0    = std::cos(w0);
+    auto const alpha     = std::sin(w0) / (2.f * std::max(settings.q, 0.001f));
+    auto const amplitude = std::pow(10.f, settings.gain_in_db / 40.f);
+    auto const normalize = [](float b0, float b1, float b2, float a0, float a1, float a2) {
+        return Coefficients{b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+    };
+
+    switch (settings.type)
+    {
+    case BiquadType::LowPass:
+        return normalize((1.f - cos_w0) / 2.f, 1.f - cos_w0, (1.f - cos_w0) / 2.f, 1.f + alpha, -2.f * cos_w0, 1.f - alpha);
+    case BiquadType::HighPass:
+        return normalize((1.f + cos_w0) / 2.f, -(1.f + cos_w0), (1.f + cos_w0) / 2.f, 1.f + alpha, -2.f * cos_w0, 1.f - alpha);
+    case BiquadType::BandPass:
+        return normalize(alpha, 0.f, -alpha, 1.f + alpha, -2.f * cos_w0, 1.f - alpha);
+    case BiquadType::Peak:
+        return normalize(1.f + alpha * amplitude, -2.f * cos_w0, 1.f - alpha * amplitude, 1.f + alpha / amplitude, -2.f * cos_w0, 1.f - alpha / amplitude);
+    }
+    return {};
+}
+
+void BiquadFilter::process(std::span<float> interleaved_block, unsigned int channels_count)
+{
+    if (_sample_rate == 0 || _channels_states.size() < channels_count)
+        return; // Not prepared for this format.
+
+    auto const settings_version = _settings_version.load(std::memory_order_acquire);
+    if (settings_version != _coefficients_version)
+    {
+        _coefficients         = compute_coefficients(settings(), _sample_rate); // Only a few trigonometric functions, we can afford it on the audio thread.
+        _coefficients_version = settings_version;
+    }
+
+    // Transposed direct form II, which has good numerical properties with floats.
+    auto const c            = _coefficients;
+    auto const frames_count = interleaved_block.size() / std::max(channels_count, 1u);
+    for (size_t channel = 0; channel < channels_count; ++channel)
+    {
+        auto state = _channels_states[channel];
+        for (size_t frame = 0; frame < frames_count; ++frame)
+        {
+            auto&      sample = interleaved_block[frame * channels_count + channel];
+            auto const input  = sample;
+            sample            = c.b0 * input + state.z1;
+            state.z1          = c.b1 * input - c.a1 * sample + state.z2;
+            state.z2          = c.b2 * input - c.a2 * sample;
+        }
+        _channels_states[channel] = state;
+    }
+}
+
+void LevelMeter::process(std::span<float> interleaved_block, unsigned int /* channels_count */)
+{
+    float peak{0.f};
+    float squares_sum{0.f};
+    for (float const sample : interleaved_block)
+    {
+        peak = std::max(peak, std::abs(sample));
+        squares_sum += sample * sample;
+    }
+    _peak.store(peak, std::memory_order_relaxed);
+    _rms.store(interleaved_block.empty() ? 0.f : std::sqrt(squares_sum / static_cast<float>(interleaved_block.size())), std::memory_order_relaxed);
+}
+
+} // namespace Audio
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Audio {
+
+struct StreamFormat {
+    unsigned int sample_rate{0};
+    unsigned int channels_count{0};
+    /// The maximum number of frames that `Processor::process()` will receive at once.
+    unsigned int max_frames_count{0};
+};
+
+/// A step of the processing chain of a `DuplexStream`.
+/// `process()` is called on the audio thread, so it MUST NOT allocate, lock a mutex, or do anything else that could take an unbounded amount of time: do all of that in `prepare()`.
+class Processor {
+public:
+    Processor()                                        = default;
+    virtual ~Processor()                               = default;
+    Processor(Processor const&)                        = delete; // Can't copy nor move
+    auto operator=(Processor const&) -> Processor&     = delete; // because the stream keeps the address of this object
+    Processor(Processor&&) noexcept                    = delete; // and uses it in the audio callback.
+    auto operator=(Processor&&) noexcept -> Processor& = delete; //
+
+    /// Called each time the stream is (re)opened, and when the processor is added to a stream that is already open.
+    /// The audio thread never calls `process()` while `prepare()` is running. This is where you should allocate all the memory you need.
+    virtual void prepare(StreamFormat const&) {}
+    /// Processes `interleaved_block` in place. Called on the audio thread.
+    virtual void process(std::span<float> interleaved_block, unsigned int channels_count) = 0;
+};
+
+/// Multiplies the signal by a gain. The changes are smoothed over one block, so that they don't produce clicks.
+class Gain : public Processor {
+public:
+    explicit Gain(float gain = 1.f)
+        : _target_gain{gain}
+        , _current_gain{gain}
+    {}
+
+    /// Can be called from any thread.
+    void set_gain(float gain) { _target_gain.store(gain, std::memory_order_relaxed); }
+    [[nodiscard]] auto gain() const -> float { return _target_gain.load(std::memory_order_relaxed); }
+
+    void process(std::span<float> interleaved_block, unsigned int channels_count) override;
+
+private:
+    std::atomic<float> _target_gain;
+    float              _current_gain; // Only used on the audio thread
+};
+
+enum class BiquadType {
+    LowPass,
+    HighPass,
+    /// Constant 0 dB peak gain.
+    BandPass,
+    /// Boosts or cuts the frequencies around `frequency_in_hz` by `gain_in_db`.
+    Peak,
+};
+
+struct BiquadSettings {
+    BiquadType type{BiquadType::LowPass};
+    float      frequency_in_hz{1000.f};
+    float      q{0.7071f};      // 1/sqrt(2) gives a flat response for low-pass and high-pass filters.
+    float      gain_in_db{0.f}; // Only used by `BiquadType::Peak`.
+};
+
+/// A second-order IIR filter (the classic ones from Robert Bristow-Johnson's "Audio EQ Cookbook").
+class BiquadFilter : public Processor {
+public:
+    explicit BiquadFilter(BiquadSettings const& = {});
+
+    /// Can be called from any thread. The audio thread recomputes the coefficients at the beginning of its next block.
+    void set_settings(BiquadSettings const&);
+    [[nodiscard]] auto settings() const -> BiquadSettings;
+
+    void prepare(StreamFormat const&) override;
+    void process(std::span<float> interleaved_block, unsigned int channels_count) override;
+
+private:
+    struct Coefficients {
+        float b0{1.f}, b1{0.f}, b2{0.f}, a1{0.f}, a2{0.f};
+    };
+    struct ChannelState {
+        float z1{0.f}, z2{0.f};
+    };
+
+    static auto compute_coefficients(BiquadSettings const&, unsigned int sample_rate) -> Coefficients;
+
+    // Written by any thread
+    std::atomic<BiquadType> _type;
+    std::atomic<float>      _frequency_in_hz;
+    std::atomic<float>      _q;
+    std::atomic<float>      _gain_in_db;
+    std::atomic<uint64_t>   _settings_version{1}; // Incremented after each change of the settings, so that the audio thread knows it needs to recompute the coefficients.
+
+    // Only used on the audio thread (and in `prepare()`)
+    Coefficients              _coefficients{};
+    std::vector<ChannelState> _channels_states{};
+    unsigned int              _sample_rate{0};
+    uint64_t                  _coefficients_version{0};
+};
+
+/// Measures the level of the signal, without modifying it.
+class LevelMeter : public Processor {
+public:
+    /// Can be called from any thread. The biggest absolute value of a sample in the latest block, over all the channels.
+    [[nodiscard]] auto peak() const -> float { return _peak.load(std::memory_order_relaxed); }
+    /// Can be called from any thread. The root mean square of the latest block, over all the channels.
+    [[nodiscard]] auto rms() const -> float { return _rms.load(std::memory_order_relaxed); }
+
+    void process(std::span<float> interleaved_block, unsigned int channels_count) override;
+
+private:
+    std::atomic<float> _peak{0.f};
+    std::atomic<float> _rms{0.f};
+};
+
+} // namespace Audio
@@ -0,0 +1,155 @@
+#include "Recorder.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include "Tracer.hpp"
+
+namespace Audio {
+
+Recorder::~Recorder()
+{
+    stop();
+}
+
+void Recorder::start(std::filesystem::path const& path, RecordingFormat format, unsigned int channels_count, unsigned int sample_rate, std::chrono::milliseconds queue_duration)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    stop();
+
+    // A big buffer, so that we write to the disk in large chunks.
+    // (It must be set before opening the file).
+    _file_buffer.resize(1024 * 1024);
+    _file = std::ofstream{};
+    _file.rdbuf()->pubsetbuf(_file_buffer.data(), static_cast<std::streamsize>(_file_buffer.size()));
+    _file.open(path, std::ios::binary | std::ios::trunc);
+    if (!_file)
+        throw std::runtime_error{"Failed to create \"" + path.string() + "\""};
+
+    _format                = format;
+    _channels_count        = std::max(channels_count, 1u);
+    _sample_rate           = sample_rate;
+    _written_samples_count = 0;
+    _written_frames_count.store(0, std::memory_order_release);
+    _dropped_frames_count.store(0, std::memory_order_release);
+    _has_write_error.store(false, std::memory_order_release);
+    if (_format == RecordingFormat::Wav)
+        update_wav_header(); // Reserve the space for the header, we will fill in the sizes as the recording goes.
+
+    auto const queue_frames_count = static_cast<uint64_t>(sample_rate) * static_cast<uint64_t>(std::max(queue_duration.count(), int64_t{1})) / 1000;
+    _fifo.reset(static_cast<size_t>(std::max(queue_frames_count, uint64_t{1})) * _channels_count);
+
+    _should_stop.store(false, std::memory_order_release);
+    _writer_thread = std::thread{[this]() { writer_thread_loop(); }};
+    _is_recording.store(true, std::memory_order_seq_cst);
+}
+
+void Recorder::stop()
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    if (!_writer_thread.joinable())
+        return;
+
+    // Make sure the audio thread is done with the queue: it checks `_is_recording` after incrementing `_pushes_in_progress`, so once the counter is back to 0 no push can be in progress.
+    _is_recording.store(false, std::memory_order_seq_cst);
+    while (_pushes_in_progress.load(std::memory_order_seq_cst) != 0)
+        std::this_thread::yield(); // A push only copies a few samples, it will be over in a few microseconds.
+
+    _should_stop.store(true, std::memory_order_release);
+    _writer_thread.join();
+    if (_format == RecordingFormat::Wav)
+        update_wav_header();
+    _file.close();
+}
+
+void Recorder::push_interleaved(float const* interleaved_data, size_t frames_count, unsigned int channels_count)
+{
+    _pushes_in_progress.fetch_add(1, std::memory_order_seq_cst);
+    if (_is_recording.load(std::memory_order_seq_cst))
+    {
+        if (channels_count != _channels_count
+            || !_fifo.try_push({interleaved_data, frames_count * channels_count}))
+            _dropped_frames_count.fetch_add(frames_count, std::memory_order_relaxed);
+    }
+    _pushes_in_progress.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void Recorder::writer_thread_loop()
+{
+    // The queue holds a few seconds of audio, so we can afford to only wake up from time to time.
+    // This is better than having the audio thread notify us, which could make it wait on a system call.
+    static constexpr auto poll_interval          = std::chrono::milliseconds{50};
+    static constexpr auto header_update_interval = std::chrono::seconds{1};
+
+    auto chunk              = std::vector<float>(_fifo.capacity());
+    auto last_header_update = std::chrono::steady_clock::now();
+    while (true)
+    {
+        bool const should_stop = _should_stop.load(std::memory_order_acquire); // Read it before draining the queue, so that we don't miss the samples that were pushed right before stop() was called.
+        for (size_t count = _fifo.pop(chunk); count != 0; count = _fifo.pop(chunk))
+            write_samples(std::span{chunk}.first(count));
+        if (should_stop)
+            return;
+
+        if (_format == RecordingFormat::Wav && std::chrono::steady_clock::now() - last_header_update >= header_update_interval)
+        {
+            update_wav_header();
+            last_header_update = std::chrono::steady_clock::now();
+        }
+        std::this_thread::sleep_for(poll_interval);
+    }
+}
+
+void Recorder::write_samples(std::span<float const> samples)
+{
+    AUDIO_TRACE_SCOPE("Recorder::write_samples");
+    if (!_has_write_error.load(std::memory_order_relaxed))
+    {
+        // The samples are written in the byte order of the machine. It is little-endian on all the platforms we support, which is what WAV files expect.
+        _file.write(reinterpret_cast<char const*>(samples.data()), static_cast<std::streamsize>(samples.size_bytes())); // NOLINT(*reinterpret-cast)
+        if (_file)
+        {
+            _written_samples_count += samples.size();
+            _written_frames_count.store(_written_samples_count / _channels_count, std::memory_order_release);
+            return;
+        }
+        _has_write_error.store(true, std::memory_order_release);
+    }
+    _dropped_frames_count.fetch_add(samples.size() / _channels_count, std::memory_order_relaxed);
+}
+
+static void write_little_endian(std::ostream& out, uint64_t value, size_t bytes_count)
+{
+    for (size_t i = 0; i < bytes_count; ++i)
+        out.put(static_cast<char>((value >> (8 * i)) & 0xFFu));
+}
+
+void Recorder::update_wav_header()
+{
+    if (_has_write_error.load(std::memory_order_relaxed))
+        return;
+
+    // The sizes are stored on 32 bits, so files bigger than 4 GB (more than 3 hours of stereo audio at 48 kHz) will have a wrong size in their header.
+    // Most readers then just read until the end of the file.
+    auto const data_size       = std::min<uint64_t>(_written_samples_count * sizeof(float), 0xFFFF'FFFFu - 36);
+    auto const bytes_per_frame = uint64_t{_channels_count} * sizeof(float);
+
+    _file.seekp(0);
+    _file.write("RIFF", 4);
+    write_little_endian(_file, 36 + data_size, 4);
+    _file.write("WAVE", 4);
+    _file.write("fmt ", 4);
+    write_little_endian(_file, 16, 4);                             // Size of the fmt chunk
+    write_little_endian(_file, 3, 2);                              // Format: IEEE float
+    write_little_endian(_file, _channels_count, 2);                //
+    write_little_endian(_file, _sample_rate, 4);                   //
+    write_little_endian(_file, _sample_rate * bytes_per_frame, 4); // Bytes per second
+    write_little_endian(_file, bytes_per_frame, 2);                // Block align
+    write_little_endian(_file, 32, 2);                             // Bits per sample
+    _file.write("data", 4);
+    write_little_endian(_file, data_size, 4);
+    _file.seekp(0, std::ios::end);
+    _file.flush();
+    if (!_file)
+        _has_write_error.store(true, std::memory_order_release);
+}
+
+} // namespace Audio
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <thread>
+#include <vector>
+#include "SampleFifo.hpp"
+
+namespace Audio {
+
+enum class RecordingFormat {
+    /// 32-bit float WAV file, that any audio software can open.
+    Wav,
+    /// Just the interleaved 32-bit float samples, without any header.
+    RawFloat32,
+};
+
+/// Writes the samples it receives from the audio thread into a file.
+/// The audio thread only copies the samples into a lock-free queue, and a background writer thread drains that queue into the file in big chunks.
+/// So the audio thread never waits, never allocates and never touches the filesystem.
+/// If the disk can't keep up and the queue gets full, the samples are dropped and counted (see `dropped_frames_count()`).
+class Recorder {
+public:
+    Recorder() = default;
+    /// Stops the recording if there was one.
+    ~Recorder();
+    Recorder(Recorder const&)                        = delete; //
+    auto operator=(Recorder const&) -> Recorder&     = delete; // Can't copy nor move
+    Recorder(Recorder&&) noexcept                    = delete; // because the writer thread uses the address of this object.
+    auto operator=(Recorder&&) noexcept -> Recorder& = delete; //
+
+    /// Stops the current recording (if any) and starts a new one in the given file.
+    /// `queue_duration` is how much audio we can hold in memory while waiting for the disk. If the disk stalls for longer than that, samples will be dropped.
+    /// Throws an exception if the file can't be created.
+    void start(std::filesystem::path const&, RecordingFormat, unsigned int channels_count, unsigned int sample_rate, std::chrono::milliseconds queue_duration = std::chrono::seconds{2});
+    /// Writes all the samples that are still in the queue, finalizes the file and closes it.
+    /// Does nothing if we are not recording.
+    void stop();
+    [[nodiscard]] auto is_recording() const -> bool { return _is_recording.load(std::memory_order_acquire); }
+
+    /// Called on the audio thread. `interleaved_data` MUST contain `frames_count * channels_count` samples.
+    /// Does nothing if we are not recording. If `channels_count` is not the one the recording has been started with (e.g. because the stream has been reopened), the samples are dropped.
+    void push_interleaved(float const* interleaved_data, size_t frames_count, unsigned int channels_count);
+
+    /// The number of frames that have been written to the file since the beginning of the recording.
+    [[nodiscard]] auto written_frames_count() const -> uint64_t { return _written_frames_count.load(std::memory_order_acquire); }
+    /// The number of frames that we had to drop since the beginning of the recording, because the disk couldn't keep up.
+    [[nodiscard]] auto dropped_frames_count() const -> uint64_t { return _dropped_frames_count.load(std::memory_order_acquire); }
+    /// True iff writing to the file has failed (e.g. the disk is full). The following samples are then dropped.
+    [[nodiscard]] auto has_write_error() const -> bool { return _has_write_error.load(std::memory_order_acquire); }
+
+private:
+    void writer_thread_loop();
+    void write_samples(std::span<float const>);
+    /// WAV files store their size in their header, so we update it from time to time. That way the file can still be read if the application crashes in the middle of a recording.
+    void update_wav_header();
+
+private:
+    // Only used by the audio thread while `_is_recording` is true
+    SampleFifo   _fifo{};
+    unsigned int _channels_count{0};
+
+    std::atomic<bool>     _is_recording{false};
+    std::atomic<uint32_t> _pushes_in_progress{0}; // So that stop() can wait until the audio thread doesn't use `_fifo` anymore.
+    std::atomic<uint64_t> _written_frames_count{0};
+    std::atomic<uint64_t> _dropped_frames_count{0};
+    std::atomic<bool>     _has_write_error{false};
+
+    // Only used by the writer thread while recording
+    std::ofstream     _file{};
+    std::vector<char> _file_buffer{};
+    RecordingFormat   _format{RecordingFormat::Wav};
+    unsigned int      _sample_rate{0};
+    uint64_t          _written_samples_count{0};
+    std::atomic<bool> _should_stop{false};
+    std::thread       _writer_thread{};
+};
+
+} // namespace Audio
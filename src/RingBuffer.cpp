@@ -0,0 +1,69 @@
+#include "RingBuffer.hpp"
+#include <algorithm>
+#include "next_power_of_two.hpp"
+
+namespace Audio {
+
+void RingBuffer::reset(unsigned int channels_count, size_t capacity_per_channel)
+{
+    _channels_count = channels_count;
+    _capacity       = next_power_of_two(capacity_per_channel);
+    _data.assign(_capacity * _channels_count, 0.f);
+    _write_index.store(0, std::memory_order_release);
+    _writing_until.store(0, std::memory_order_release);
+}
+
+void RingBuffer::push_interleaved(float const* interleaved_data, size_t frames_count)
+{
+    if (_capacity == 0)
+        return;
+    auto const mask        = _capacity - 1;
+    auto const write_index = _write_index.load(std::memory_order_relaxed);
+    _writing_until.store(write_index + frames_count, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // The consumer must not see any of the samples below without also seeing the new `_writing_until`.
+    for (size_t frame = 0; frame < frames_count; ++frame)
+    {
+        auto const position = static_cast<size_t>(write_index + frame) & mask;
+        for (size_t channel = 0; channel < _channels_count; ++channel)
+            _data[channel * _capacity + position] = interleaved_data[frame * _channels_count + channel]; // NOLINT(*pointer-arithmetic)
+    }
+    _write_index.store(write_index + frames_count, std::memory_order_release); // Publish the new samples only once they have all been written.
+}
+
+auto RingBuffer::read_latest(std::span<float> destination, unsigned int channel_index) const -> bool
+{
+    if (channel_index >= _channels_count)
+    {
+        std::fill(destination.begin(), destination.end(), 0.f);
+        return true;
+    }
+    auto const requested_count = static_cast<uint64_t>(destination.size());
+
+    // The producer might overwrite the samples while we are copying them. When that happens, we just try again.
+    static constexpr int max_attempts = 4;
+    for (int attempt = 0; attempt < max_attempts; ++attempt)
+    {
+        auto const write_index     = _write_index.load(std::memory_order_acquire);
+        auto const available_count = std::min({requested_count, write_index, static_cast<uint64_t>(_capacity)});
+        auto const missing_count   = static_cast<size_t>(requested_count - available_count);
+        std::fill_n(destination.begin(), missing_count, 0.f);
+
+        auto const mask       = _capacity - 1;
+        auto const first_read = static_cast<size_t>(write_index - available_count);
+        for (size_t i = 0; i < available_count; ++i)
+            destination[missing_count + i] = _data[channel_index * _capacity + ((first_read + i) & mask)];
+
+        // The oldest sample we copied is still valid iff the producer hasn't wrapped around it in the meantime.
+        // This includes the block it might be writing right now, which hasn't been published in `_write_index` yet.
+        std::atomic_thread_fence(std::memory_order_acquire); // The load below must not happen before we are done copying.
+        auto const writing_until = _writing_until.load(std::memory_order_relaxed);
+        if (writing_until - (write_index - available_count) <= _capacity)
+            return true;
+    }
+
+    // Better give silence than samples that are a mix of the old and the new ones.
+    std::fill(destination.begin(), destination.end(), 0.f);
+    return false;
+}
+
+} // namespace Audio
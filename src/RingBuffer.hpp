@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Audio {
+
+/// Keeps the latest samples of several channels, stored one after the other (planar layout).
+/// It is lock-free and meant to have exactly one producer (the audio thread) and one consumer.
+/// The producer never waits: when the buffer is full the oldest samples are simply overwritten.
+class RingBuffer {
+public:
+    RingBuffer() = default;
+
+    /// Clears the buffer and changes its size. The capacity is rounded up to the next power of two.
+    /// /!\ This is NOT thread-safe: the producer must not be running while you call it.
+    void reset(unsigned int channels_count, size_t capacity_per_channel);
+
+    [[nodiscard]] auto channels_count() const -> unsigned int { return _channels_count; }
+    [[nodiscard]] auto capacity() const -> size_t { return _capacity; }
+
+    /// Producer side. `interleaved_data` MUST contain `frames_count * channels_count()` samples.
+    /// Deinterleaves all the channels in a single pass over the data.
+    void push_interleaved(float const* interleaved_data, size_t frames_count);
+
+    /// Consumer side. Copies the `destination.size()` latest samples of the given channel into `destination`, the most recent sample being the last one.
+    /// If less samples than that have been pushed, the beginning of `destination` is filled with 0s.
+    /// If the channel doesn't exist, `destination` is filled with 0s.
+    /// Returns false iff the producer kept overwriting the samples while we were copying them (i.e. `destination` is too big compared to the capacity), in which case `destination` is filled with 0s.
+    auto read_latest(std::span<float> destination, unsigned int channel_index) const -> bool;
+
+private:
+    std::vector<float>    _data{};
+    unsigned int          _channels_count{0};
+    size_t                _capacity{0};
+    std::atomic<uint64_t> _write_index{0};   // Total number of frames that have been pushed since the last reset().
+    std::atomic<uint64_t> _writing_until{0}; // End of the block that the producer is currently writing (or has last written), so that the consumer knows which samples might be overwritten while it copies them.
+};
+
+} // namespace Audio
@@ -0,0 +1,45 @@
+#include "SampleFifo.hpp"
+#include <algorithm>
+#include "next_power_of_two.hpp"
+
+namespace Audio {
+
+void SampleFifo::reset(size_t capacity)
+{
+    _capacity = next_power_of_two(capacity);
+    _data.assign(_capacity, 0.f);
+    _write_index.store(0, std::memory_order_release);
+    _read_index.store(0, std::memory_order_release);
+}
+
+auto SampleFifo::try_push(std::span<float const> samples) -> bool
+{
+    auto const write_index = _write_index.load(std::memory_order_relaxed);
+    auto const read_index  = _read_index.load(std::memory_order_acquire); // Acquire, so that we don't overwrite samples that the consumer is still copying.
+    if (_capacity - static_cast<size_t>(write_index - read_index) < samples.size())
+        return false;
+
+    // Copy in (at most) two parts, because the samples might wrap around the end of the buffer.
+    auto const position    = static_cast<size_t>(write_index) & (_capacity - 1);
+    auto const first_count = std::min(samples.size(), _capacity - position);
+    std::copy_n(samples.begin(), first_count, _data.begin() + static_cast<std::ptrdiff_t>(position));
+    std::copy(samples.begin() + static_cast<std::ptrdiff_t>(first_count), samples.end(), _data.begin());
+    _write_index.store(write_index + samples.size(), std::memory_order_release); // Publish the new samples only once they have all been written.
+    return true;
+}
+
+auto SampleFifo::pop(std::span<float> destination) -> size_t
+{
+    auto const read_index  = _read_index.load(std::memory_order_relaxed);
+    auto const write_index = _write_index.load(std::memory_order_acquire);
+    auto const count       = std::min(destination.size(), static_cast<size_t>(write_index - read_index));
+
+    auto const position    = static_cast<size_t>(read_index) & (_capacity - 1);
+    auto const first_count = std::min(count, _capacity - position);
+    std::copy_n(_data.begin() + static_cast<std::ptrdiff_t>(position), first_count, destination.begin());
+    std::copy_n(_data.begin(), count - first_count, destination.begin() + static_cast<std::ptrdiff_t>(first_count));
+    _read_index.store(read_index + count, std::memory_order_release); // Give the room back to the producer only once we are done copying.
+    return count;
+}
+
+} // namespace Audio
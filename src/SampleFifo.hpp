@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Audio {
+
+/// A queue of samples that is lock-free and meant to have exactly one producer (the audio thread) and one consumer.
+/// Unlike `RingBuffer`, it never overwrites anything: if the consumer doesn't keep up, the producer is told that there is no room left.
+class SampleFifo {
+public:
+    SampleFifo() = default;
+
+    /// Clears the queue and changes its size. The capacity is rounded up to the next power of two.
+    /// /!\ This is NOT thread-safe: neither the producer nor the consumer must be running while you call it.
+    void reset(size_t capacity);
+
+    [[nodiscard]] auto capacity() const -> size_t { return _capacity; }
+
+    /// Producer side. Pushes all the samples, or none of them if there isn't enough room for all of them.
+    /// Returns false iff the samples were not pushed.
+    auto try_push(std::span<float const> samples) -> bool;
+    /// Consumer side. Pops as many samples as possible (up to `destination.size()`) and returns their count.
+    auto pop(std::span<float> destination) -> size_t;
+
+private:
+    std::vector<float>    _data{};
+    size_t                _capacity{0};
+    std::atomic<uint64_t> _write_index{0}; // Total number of samples that have been pushed since the last reset().
+    std::atomic<uint64_t> _read_index{0};  // Total number of samples that have been popped since the last reset().
+};
+
+} // namespace Audio
@@ -0,0 +1,555 @@
+#include "SeekTable.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "Tracer.hpp"
+
+namespace Audio {
+
+SeekTable::SeekTable(std::vector<SeekPoint> points, uint64_t frames_count, unsigned int sample_rate)
+    : _points{std::move(points)}
+    , _frames_count{frames_count}
+    , _sample_rate{sample_rate}
+{
+    assert(std::is_sorted(_points.begin(), _points.end(), [](SeekPoint const& a, SeekPoint const& b) { return a.frame_index < b.frame_index; }));
+}
+
+auto SeekTable::constant_bitrate(uint64_t first_frame_byte_offset, uint64_t bytes_per_frame, uint64_t frames_count, unsigned int sample_rate) -> SeekTable
+{
+    auto res             = SeekTable{{SeekPoint{0, first_frame_byte_offset}}, frames_count, sample_rate};
+    res._bytes_per_frame = bytes_per_frame;
+    return res;
+}
+
+auto SeekTable::find(uint64_t frame_index) const -> SeekPoint
+{
+    assert(!empty());
+    if (_bytes_per_frame != 0)
+    {
+        if (_frames_count != 0)
+            frame_index = std::min(frame_index, _frames_count);
+        return {frame_index, _points[0].byte_offset + frame_index * _bytes_per_frame};
+    }
+
+    auto const it = std::upper_bound(_points.begin(), _points.end(), frame_index, [](uint64_t frame, SeekPoint const& point) {
+        return frame < point.frame_index;
+    });
+    return it == _points.begin() ? _points.front() : *std::prev(it);
+}
+
+auto SeekTable::find_time(double time_in_seconds) const -> SeekPoint
+{
+    return find(static_cast<uint64_t>(std::max(time_in_seconds, 0.) * static_cast<double>(_sample_rate)));
+}
+
+namespace {
+class FileReader {
+public:
+    explicit FileReader(std::filesystem::path const& path)
+        : _file{path, std::ios::binary}
+    {
+        if (!_file)
+            throw std::runtime_error{"Failed to open \"" + path.string() + "\""};
+        _size = std::filesystem::file_size(path);
+    }
+
+    [[nodiscard]] auto size() const -> uint64_t { return _size; }
+
+    /// Returns the number of bytes that have actually been read (less than `destination.size()` if we reached the end of the file).
+    auto read(uint64_t offset, std::span<uint8_t> destination) -> size_t
+    {
+        if (offset >= _size)
+            return 0;
+        _file.clear(); // Reset the eof flag that might have been set by a previous read.
+        _file.seekg(static_cast<std::streamoff>(offset));
+        _file.read(reinterpret_cast<char*>(destination.data()), static_cast<std::streamsize>(destination.size())); // NOLINT(*reinterpret-cast)
+        return static_cast<size_t>(_file.gcount());
+    }
+
+    /// Returns false if there weren't enough bytes in the file.
+    auto read_exactly(uint64_t offset, std::span<uint8_t> destination) -> bool
+    {
+        return read(offset, destination) == destination.size();
+    }
+
+private:
+    std::ifstream _file;
+    uint64_t      _size{};
+};
+
+struct Mp3FrameHeader {
+    uint64_t     size;           // In bytes, including the header.
+    uint64_t     frames_count;   // The number of audio frames the decoder outputs for this MP3 frame.
+    unsigned int sample_rate;    //
+    uint64_t     side_info_size; // Only for Layer III, 0 otherwise.
+};
+
+struct FlacStreamInfo {
+    uint64_t     min_block_size{0};
+    uint64_t     min_frame_size{0}; // 0 if unknown
+    uint64_t     frames_count{0};   // 0 if unknown
+    unsigned int sample_rate{0};
+};
+} // namespace
+
+static auto read_little_endian(std::span<uint8_t const> bytes) -> uint64_t
+{
+    uint64_t res{0};
+    for (auto it = bytes.rbegin(); it != bytes.rend(); ++it)
+        res = (res << 8) | *it;
+    return res;
+}
+
+static auto read_big_endian(std::span<uint8_t const> bytes) -> uint64_t
+{
+    uint64_t res{0};
+    for (auto const byte : bytes)
+        res = (res << 8) | byte;
+    return res;
+}
+
+static auto starts_with(std::span<uint8_t const> bytes, std::string_view magic) -> bool
+{
+    return bytes.size() >= magic.size() && std::memcmp(bytes.data(), magic.data(), magic.size()) == 0;
+}
+
+static auto saturating_subtraction(uint64_t a, uint64_t b) -> uint64_t
+{
+    return a > b ? a - b : 0;
+}
+
+/// Returns the number of bytes used by the ID3v2 tag at the beginning of the file (0 if there is none).
+static auto id3v2_tag_size(FileReader& file) -> uint64_t
+{
+    auto header = std::array<uint8_t, 10>{};
+    if (!file.read_exactly(0, header) || !starts_with(header, "ID3"))
+        return 0;
+    // The size is stored on 4 bytes, using only 7 bits of each byte.
+    auto const size       = (uint64_t{header[6] & 0x7Fu} << 21) | (uint64_t{header[7] & 0x7Fu} << 14) | (uint64_t{header[8] & 0x7Fu} << 7) | uint64_t{header[9] & 0x7Fu};
+    auto const has_footer = (header[5] & 0x10u) != 0;
+    return 10 + size + (has_footer ? 10 : 0);
+}
+
+/* ---------------------------------------------- WAV --------------------------------------------- */
+
+static auto build_wav_seek_table(FileReader& file) -> SeekTable
+{
+    auto     chunk_header = std::array<uint8_t, 8>{};
+    auto     format       = std::array<uint8_t, 16>{};
+    uint64_t block_align{0};
+    uint64_t sample_rate{0};
+    for (uint64_t offset = 12; file.read_exactly(offset, chunk_header);)
+    {
+        auto const chunk_size = read_little_endian(std::span{chunk_header}.subspan(4));
+        if (starts_with(chunk_header, "fmt ") && file.read_exactly(offset + 8, format))
+        {
+            sample_rate = read_little_endian(std::span{format}.subspan(4, 4));
+            block_align = read_little_endian(std::span{format}.subspan(12, 2));
+        }
+        else if (starts_with(chunk_header, "data") && block_align != 0)
+        {
+            auto const data_offset = offset + 8;
+            auto const data_size   = std::min(chunk_size, file.size() - data_offset); // The size is sometimes wrong in files that have been written by streaming apps.
+            return SeekTable::constant_bitrate(data_offset, block_align, data_size / block_align, static_cast<unsigned int>(sample_rate));
+        }
+        offset += 8 + chunk_size + chunk_size % 2; // Chunks are padded to an even size.
+    }
+    return {};
+}
+
+/* ---------------------------------------------- MP3 --------------------------------------------- */
+
+static auto parse_mp3_frame_header(std::span<uint8_t const> header) -> std::optional<Mp3FrameHeader>
+{
+    static constexpr auto bitrates_in_kbps = std::array<std::array<uint64_t, 16>, 5>{{
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0}, // MPEG 1, Layer I
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},    // MPEG 1, Layer II
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},     // MPEG 1, Layer III
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},    // MPEG 2 and 2.5, Layer I
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},         // MPEG 2 and 2.5, Layers II and III
+    }};
+    static constexpr auto sample_rates = std::array<std::array<unsigned int, 3>, 3>{{
+        {44100, 48000, 32000}, // MPEG 1
+        {22050, 24000, 16000}, // MPEG 2
+        {11025, 12000, 8000},  // MPEG 2.5
+    }};
+
+    if (header.size() < 4 || header[0] != 0xFF || (header[1] & 0xE0u) != 0xE0u)
+        return std::nullopt;
+    auto const version_bits      = (header[1] >> 3u) & 0b11u; // 0: MPEG 2.5, 1: reserved, 2: MPEG 2, 3: MPEG 1
+    auto const layer_bits        = (header[1] >> 1u) & 0b11u; // 0: reserved, 1: Layer III, 2: Layer II, 3: Layer I
+    auto const bitrate_index     = static_cast<unsigned int>(header[2] >> 4u);
+    auto const sample_rate_index = (header[2] >> 2u) & 0b11u;
+    auto const padding           = uint64_t{(header[2] >> 1u) & 1u};
+    auto const is_mono           = (header[3] >> 6u) == 0b11u;
+    if (version_bits == 1 || layer_bits == 0 || sample_rate_index == 3
+        || bitrate_index == 0 // "Free format": the size of the frames is not specified, so we can't jump from one to the next.
+        || bitrate_index == 15)
+        return std::nullopt;
+
+    auto const is_mpeg1    = version_bits == 3;
+    auto const layer       = 4 - layer_bits;
+    auto const bitrate     = 1000 * bitrates_in_kbps[is_mpeg1 ? layer - 1 : (layer == 1 ? 3 : 4)][bitrate_index];
+    auto const sample_rate = sample_rates[is_mpeg1 ? 0 : (version_bits == 2 ? 1 : 2)][sample_rate_index];
+    if (layer == 1)
+        return Mp3FrameHeader{(12 * bitrate / sample_rate + padding) * 4, 384, sample_rate, 0};
+    if (layer == 2)
+        return Mp3FrameHeader{144 * bitrate / sample_rate + padding, 1152, sample_rate, 0};
+    return Mp3FrameHeader{
+        (is_mpeg1 ? 144 : 72) * bitrate / sample_rate + padding,
+        is_mpeg1 ? 1152u : 576u,
+        sample_rate,
+        is_mpeg1 ? (is_mono ? 17u : 32u) : (is_mono ? 9u : 17u),
+    };
+}
+
+/// The first frame of a VBR file usually contains a Xing / Info / VBRI header instead of audio, and decoders skip it.
+static auto is_metadata_frame(FileReader& file, uint64_t frame_offset, Mp3FrameHeader const& frame) -> bool
+{
+    auto tag = std::array<uint8_t, 4>{};
+    if (frame.side_info_size != 0
+        && file.read_exactly(frame_offset + 4 + frame.side_info_size, tag)
+        && (starts_with(tag, "Xing") || starts_with(tag, "Info")))
+        return true;
+    return file.read_exactly(frame_offset + 4 + 32, tag) && starts_with(tag, "VBRI");
+}
+
+/// Looks for the first frame at or after `offset`.
+/// Random data can look like a frame header, so we only accept a header if it is followed by another frame (or by the end of the file).
+static auto find_next_mp3_frame(FileReader& file, uint64_t offset) -> std::optional<std::pair<uint64_t, Mp3FrameHeader>>
+{
+    auto buffer      = std::vector<uint8_t>(4096);
+    auto next_header = std::array<uint8_t, 4>{};
+    while (true)
+    {
+        auto const bytes_count = file.read(offset, buffer);
+        if (bytes_count < 4)
+            return std::nullopt;
+        for (size_t i = 0; i + 4 <= bytes_count; ++i)
+        {
+            auto const frame = parse_mp3_frame_header(std::span{buffer}.subspan(i, 4));
+            if (!frame)
+                continue;
+            auto const next_offset = offset + i + frame->size;
+            if (next_offset == file.size())
+                return std::make_pair(offset + i, *frame);
+            auto const next_frame = file.read_exactly(next_offset, next_header) ? parse_mp3_frame_header(next_header) : std::nullopt;
+            if (next_frame && next_frame->sample_rate == frame->sample_rate)
+                return std::make_pair(offset + i, *frame);
+        }
+        offset += bytes_count - 3; // Overlap the reads, so that we don't miss a header that would be split between two of them.
+    }
+}
+
+static auto build_mp3_seek_table(FileReader& file, uint64_t first_byte) -> SeekTable
+{
+    auto const first_frame = find_next_mp3_frame(file, first_byte);
+    if (!first_frame)
+        return {};
+
+    auto points       = std::vector<SeekPoint>{};
+    auto frames_count = uint64_t{0};
+    auto offset       = first_frame->first;
+    if (is_metadata_frame(file, offset, first_frame->second))
+        offset += first_frame->second.size;
+
+    auto header = std::array<uint8_t, 4>{};
+    while (true)
+    {
+        auto frame = file.read_exactly(offset, header) ? parse_mp3_frame_header(header) : std::nullopt;
+        if (!frame) // We lost the sync (corrupted data, or tags at the end of the file), so look for the next frame.
+        {
+            auto const next_frame = find_next_mp3_frame(file, offset + 1);
+            if (!next_frame)
+                break;
+            offset = next_frame->first;
+            frame  = next_frame->second;
+        }
+        points.push_back({frames_count, offset});
+        frames_count += frame->frames_count;
+        offset += frame->size;
+    }
+    return SeekTable{std::move(points), frames_count, first_frame->second.sample_rate};
+}
+
+/* ---------------------------------------------- OGG --------------------------------------------- */
+
+static auto build_ogg_seek_table(FileReader& file) -> SeekTable
+{
+    static constexpr auto no_granule_position = ~uint64_t{0}; // Pages where no packet ends don't have a position.
+
+    auto                    points            = std::vector<SeekPoint>{};
+    auto                    page_header       = std::array<uint8_t, 27>{};
+    auto                    segments_sizes    = std::array<uint8_t, 255>{};
+    auto                    codec_header      = std::array<uint8_t, 16>{};
+    std::optional<uint64_t> serial_number     = std::nullopt; // We only index the first logical stream of the file.
+    unsigned int            sample_rate       = 0;
+    uint64_t                pre_skip          = 0; // The number of frames that Opus decoders drop at the beginning of the stream.
+    uint64_t                previous_position = 0;
+    uint64_t                offset            = 0;
+    while (file.read_exactly(offset, page_header) && starts_with(page_header, "OggS"))
+    {
+        auto const segments = std::span{segments_sizes}.first(page_header[26]);
+        if (!file.read_exactly(offset + page_header.size(), segments))
+            break;
+        auto const body_offset = offset + page_header.size() + segments.size();
+        auto const position    = read_little_endian(std::span{page_header}.subspan(6, 8));
+        auto const page_serial = read_little_endian(std::span{page_header}.subspan(14, 4));
+
+        if (!serial_number) // The first page contains the identification header of the codec.
+        {
+            serial_number = page_serial;
+            if (!file.read_exactly(body_offset, codec_header))
+                return {};
+            if (starts_with(codec_header, "\x01vorbis"))
+            {
+                sample_rate = static_cast<unsigned int>(read_little_endian(std::span{codec_header}.subspan(12, 4)));
+            }
+            else if (starts_with(codec_header, "OpusHead"))
+            {
+                sample_rate = 48000; // The positions are always expressed at 48 kHz, whatever the sample rate of the original file.
+                pre_skip    = read_little_endian(std::span{codec_header}.subspan(10, 2));
+            }
+            else
+            {
+                return {}; // We don't know how to interpret the positions of other codecs.
+            }
+        }
+        else if (page_serial == *serial_number && position != no_granule_position && position > previous_position)
+        {
+            // The position of a page is the one of its last frame, so decoding from the start of this page gives the frames that come right after the previous page.
+            points.push_back({saturating_subtraction(previous_position, pre_skip), offset});
+            previous_position = position;
+        }
+
+        auto body_size = uint64_t{0};
+        for (auto const size : segments)
+            body_size += size;
+        offset = body_offset + body_size;
+    }
+    if (points.empty())
+        return {};
+    return SeekTable{std::move(points), saturating_subtraction(previous_position, pre_skip), sample_rate};
+}
+
+/* ---------------------------------------------- FLAC -------------------------------------------- */
+
+static auto crc8(std::span<uint8_t const> bytes) -> uint8_t
+{
+    uint8_t crc{0};
+    for (auto const byte : bytes)
+    {
+        crc ^= byte;
+        for (int i = 0; i < 8; ++i)
+            crc = static_cast<uint8_t>((crc & 0x80u) != 0 ? (crc << 1u) ^ 0x07u : crc << 1u);
+    }
+    return crc;
+}
+
+/// Returns the index of the first frame of the FLAC frame whose header starts at the beginning of `bytes`, or nullopt if it is not a valid header.
+static auto parse_flac_frame_header(std::span<uint8_t const> bytes, FlacStreamInfo const& info) -> std::optional<uint64_t>
+{
+    if (bytes.size() < 6 || bytes[0] != 0xFF || (bytes[1] & 0xFEu) != 0xF8u)
+        return std::nullopt;
+    auto const has_variable_block_size = (bytes[1] & 1u) != 0;
+    auto const block_size_code         = bytes[2] >> 4u;
+    auto const sample_rate_code        = bytes[2] & 0x0Fu;
+    auto const channels_code           = bytes[3] >> 4u;
+    auto const sample_size_code        = (bytes[3] >> 1u) & 0b111u;
+    if (block_size_code == 0 || sample_rate_code == 15 || channels_code > 10 || sample_size_code == 3 || (bytes[3] & 1u) != 0)
+        return std::nullopt;
+
+    // The frame (or sample) number is encoded like a UTF-8 character: the number of leading 1s of the first byte tells how many bytes follow.
+    size_t leading_ones = 0;
+    while (leading_ones < 8 && (bytes[4] & (0x80u >> leading_ones)) != 0)
+        ++leading_ones;
+    if (leading_ones == 1 || leading_ones == 8)
+        return std::nullopt;
+    auto const continuation_size = leading_ones == 0 ? 0 : leading_ones - 1;
+    auto       number            = uint64_t{bytes[4] & (0xFFu >> (leading_ones + 1))};
+
+    size_t position = 5;
+    for (size_t i = 0; i < continuation_size; ++i, ++position)
+    {
+        if (position >= bytes.size() || (bytes[position] & 0xC0u) != 0x80u)
+            return std::nullopt;
+        number = (number << 6) | (bytes[position] & 0x3Fu);
+    }
+    position += block_size_code == 6 ? 1 : (block_size_code == 7 ? 2 : 0);                           // Block size stored at the end of the header
+    position += sample_rate_code == 12 ? 1 : (sample_rate_code == 13 || sample_rate_code == 14 ? 2 : 0); // Sample rate stored at the end of the header
+    if (position >= bytes.size() || crc8(bytes.first(position)) != bytes[position])
+        return std::nullopt;
+
+    return has_variable_block_size ? number : number * info.min_block_size;
+}
+
+/// FLAC frames don't have a size in their header, so we have to search for all the frame headers in the file.
+static auto scan_flac_frames(FileReader& file, uint64_t offset, FlacStreamInfo const& info) -> std::vector<SeekPoint>
+{
+    static constexpr size_t max_header_size = 16;
+
+    auto points = std::vector<SeekPoint>{};
+    auto buffer = std::vector<uint8_t>(64 * 1024);
+    while (true)
+    {
+        auto const bytes_count   = file.read(offset, buffer);
+        auto const is_last_chunk = bytes_count < buffer.size();
+        auto const end           = is_last_chunk ? bytes_count : bytes_count - max_header_size; // Overlap the reads, so that we don't miss a header that would be split between two of them.
+        size_t     i             = 0;
+        while (i < end)
+        {
+            auto const frame_index = parse_flac_frame_header(std::span{buffer}.subspan(i, bytes_count - i), info);
+            if (frame_index && (points.empty() || *frame_index > points.back().frame_index)) // Checking the order also filters out the (very unlikely) bytes that would look like a header and pass the CRC by chance.
+            {
+                points.push_back({*frame_index, offset + i});
+                i += std::max<uint64_t>(info.min_frame_size, 1);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        if (is_last_chunk)
+            break;
+        offset += i;
+    }
+    return points;
+}
+
+static auto build_flac_seek_table(FileReader& file, uint64_t first_byte) -> SeekTable
+{
+    auto info              = FlacStreamInfo{};
+    auto seek_table_points = std::vector<SeekPoint>{};
+    auto block_header      = std::array<uint8_t, 4>{};
+    auto offset            = first_byte + 4; // Skip the "fLaC" marker.
+    for (bool is_last_block = false; !is_last_block;)
+    {
+        if (!file.read_exactly(offset, block_header))
+            return {};
+        is_last_block          = (block_header[0] & 0x80u) != 0;
+        auto const block_type  = block_header[0] & 0x7Fu;
+        auto const block_size  = read_big_endian(std::span{block_header}.subspan(1));
+        auto const body_offset = offset + block_header.size();
+        if (block_type == 0) // STREAMINFO
+        {
+            auto stream_info = std::array<uint8_t, 18>{};
+            if (!file.read_exactly(body_offset, stream_info))
+                return {};
+            info.min_block_size = read_big_endian(std::span{stream_info}.subspan(0, 2));
+            info.min_frame_size = read_big_endian(std::span{stream_info}.subspan(4, 3));
+            info.sample_rate    = static_cast<unsigned int>(read_big_endian(std::span{stream_info}.subspan(10, 3)) >> 4); // 20 bits
+            info.frames_count   = read_big_endian(std::span{stream_info}.subspan(13, 5)) & 0xF'FFFF'FFFFu; // 36 bits
+        }
+        else if (block_type == 3) // SEEKTABLE
+        {
+            static constexpr auto placeholder = ~uint64_t{0};
+            auto                  seek_table  = std::vector<uint8_t>(block_size);
+            if (!file.read_exactly(body_offset, seek_table))
+                return {};
+            for (size_t i = 0; i + 18 <= seek_table.size(); i += 18)
+            {
+                auto const frame_index = read_big_endian(std::span{seek_table}.subspan(i, 8));
+                if (frame_index != placeholder)
+                    seek_table_points.push_back({frame_index, read_big_endian(std::span{seek_table}.subspan(i + 8, 8))});
+            }
+        }
+        offset = body_offset + block_size;
+    }
+
+    auto const first_frame_offset = offset;
+    if (seek_table_points.empty())
+        return SeekTable{scan_flac_frames(file, first_frame_offset, info), info.frames_count, info.sample_rate};
+
+    // The offsets of the SEEKTABLE are relative to the first frame.
+    for (auto& point : seek_table_points)
+        point.byte_offset += first_frame_offset;
+    if (seek_table_points.front().frame_index != 0)
+        seek_table_points.insert(seek_table_points.begin(), SeekPoint{0, first_frame_offset});
+    return SeekTable{std::move(seek_table_points), info.frames_count, info.sample_rate};
+}
+
+/* ------------------------------------------------------------------------------------------------ */
+
+static auto has_mp3_extension(std::filesystem::path const& path) -> bool
+{
+    auto extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+    return extension == ".mp3" || extension == ".mp2" || extension == ".mp1";
+}
+
+auto build_seek_table(std::filesystem::path const& path) -> SeekTable
+{
+    AUDIO_TRACE_SCOPE("build_seek_table");
+    auto file  = FileReader{path};
+    auto magic = std::array<uint8_t, 12>{};
+    file.read(0, magic);
+    if (starts_with(magic, "RIFF") && starts_with(std::span{magic}.subspan(8), "WAVE"))
+        return build_wav_seek_table(file);
+    if (starts_with(magic, "OggS"))
+        return build_ogg_seek_table(file);
+
+    // MP3 and FLAC files can start with an ID3 tag.
+    auto const first_byte = id3v2_tag_size(file);
+    if (file.read(first_byte, magic) >= 4 && starts_with(magic, "fLaC"))
+        return build_flac_seek_table(file, first_byte);
+    if (first_byte != 0 || has_mp3_extension(path)) // MP3 files don't have a magic number, so we can't recognize them from their content alone.
+        return build_mp3_seek_table(file, first_byte);
+    return {};
+}
+
+auto cached_seek_table(std::filesystem::path const& path) -> std::shared_ptr<SeekTable const>
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    AUDIO_TRACE_SCOPE("cached_seek_table");
+    static constexpr size_t max_cached_tables_count = 256; // The tables are small (a few kilobytes for an hour of MP3), but don't grow forever in applications that browse through lots of files.
+
+    struct CachedTable {
+        uintmax_t                        file_size;
+        std::filesystem::file_time_type  last_write_time;
+        std::shared_ptr<SeekTable const> table;
+        uint64_t                         last_use; // So that we can evict the least recently used table.
+    };
+    static auto       cache = std::map<std::filesystem::path, CachedTable>{};
+    static uint64_t   uses_count{0};
+    static std::mutex cache_mutex{};
+
+    auto const key             = std::filesystem::absolute(path).lexically_normal();
+    auto const file_size       = std::filesystem::file_size(path);
+    auto const last_write_time = std::filesystem::last_write_time(path);
+    {
+        std::lock_guard const lock{cache_mutex};
+        auto const            it = cache.find(key);
+        if (it != cache.end() && it->second.file_size == file_size && it->second.last_write_time == last_write_time)
+        {
+            it->second.last_use = ++uses_count;
+            return it->second.table;
+        }
+    }
+
+    auto table = std::make_shared<SeekTable const>(build_seek_table(path)); // Don't hold the lock while scanning, so that several files can be scanned concurrently (e.g. by the AudioLoader).
+
+    std::lock_guard const lock{cache_mutex};
+    cache[key] = {file_size, last_write_time, table, ++uses_count};
+    if (cache.size() > max_cached_tables_count)
+    {
+        // O(n), but only after scanning a file, which is way slower anyway.
+        cache.erase(std::min_element(cache.begin(), cache.end(), [](auto const& a, auto const& b) {
+            return a.second.last_use < b.second.last_use;
+        }));
+    }
+    return table;
+}
+
+} // namespace Audio
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace Audio {
+
+struct SeekPoint {
+    /// The first frame that the decoder outputs when it starts decoding at `byte_offset`.
+    uint64_t frame_index{0};
+    /// From the beginning of the file.
+    uint64_t byte_offset{0};
+
+    friend auto operator==(SeekPoint const&, SeekPoint const&) -> bool = default;
+};
+
+/// Maps positions in time (in frames) to positions in a compressed file (in bytes), so that a decoder can jump close to any moment of the file instead of decoding it from the start.
+/// The frame indices are the ones of the decoder's output, before any gapless trimming (e.g. the encoder delay of MP3 files is included).
+class SeekTable {
+public:
+    SeekTable() = default;
+    /// `points` MUST be sorted by `frame_index`.
+    SeekTable(std::vector<SeekPoint> points, uint64_t frames_count, unsigned int sample_rate);
+    /// For uncompressed formats, where all the frames have the same size: we don't need to store any point, we can compute them.
+    [[nodiscard]] static auto constant_bitrate(uint64_t first_frame_byte_offset, uint64_t bytes_per_frame, uint64_t frames_count, unsigned int sample_rate) -> SeekTable;
+
+    /// True iff we don't know anything about the file (e.g. its format is not supported).
+    [[nodiscard]] auto empty() const -> bool { return _points.empty(); }
+    [[nodiscard]] auto points() const -> std::vector<SeekPoint> const& { return _points; }
+    /// 0 if unknown.
+    [[nodiscard]] auto frames_count() const -> uint64_t { return _frames_count; }
+    /// 0 if unknown.
+    [[nodiscard]] auto sample_rate() const -> unsigned int { return _sample_rate; }
+
+    /// Returns the last point at or before `frame_index`: start decoding at its `byte_offset`, and drop the first `frame_index - point.frame_index` frames that come out of the decoder.
+    /// O(log(points count)), or O(1) for uncompressed formats. The table MUST NOT be empty.
+    [[nodiscard]] auto find(uint64_t frame_index) const -> SeekPoint;
+    /// Same as `find()`, with a time in seconds.
+    /// (Not an overload of `find()`, otherwise `find(1000)` would be ambiguous).
+    [[nodiscard]] auto find_time(double time_in_seconds) const -> SeekPoint;
+
+private:
+    std::vector<SeekPoint> _points{};
+    uint64_t               _bytes_per_frame{0}; // Only used by constant-bitrate tables, 0 otherwise.
+    uint64_t               _frames_count{0};
+    unsigned int           _sample_rate{0};
+};
+
+enum class SeekTableMode {
+    /// Don't build any seek table.
+    None,
+    /// Scan the file to build its seek table.
+    Build,
+    /// Reuse the table built the last time this file was scanned (as long as its size and last write time haven't changed), or scan it if there is none.
+    Cached,
+};
+
+/// Scans the file to build its seek table, without decoding any audio.
+/// Supports WAV, MP3, OGG (Vorbis and Opus) and FLAC. Returns an empty table for other formats.
+/// For MP3 and OGG this only reads the frame / page headers. FLAC files have no frame index,
+/// so unless the file contains a SEEKTABLE block we have to search the whole file for frame headers (which is still much faster than decoding it).
+/// Throws an exception if the file can't be read.
+auto build_seek_table(std::filesystem::path const&) -> SeekTable;
+/// Same as `build_seek_table()`, but keeps the tables in a process-wide cache, so that each file is only scanned once (as long as it doesn't change).
+/// The cache keeps the tables of the 256 most recently requested files, older ones will be scanned again if they are requested again.
+/// Thread-safe.
+auto cached_seek_table(std::filesystem::path const&) -> std::shared_ptr<SeekTable const>;
+
+} // namespace Audio
@@ -0,0 +1,148 @@
+#include "StreamController.hpp"
+#include <algorithm>
+#include "Tracer.hpp"
+
+namespace Audio {
+
+static constexpr int  max_attempts_count = 6;
+static constexpr auto first_retry_delay  = std::chrono::milliseconds{100};
+static constexpr auto max_retry_delay    = std::chrono::milliseconds{5000};
+
+static constexpr auto periodic_check_interval = std::chrono::seconds{3};
+
+StreamController::StreamController(RtAudioErrorCallback error_callback)
+    : _thread{[this, error_callback = std::move(error_callback)]() mutable { control_thread_loop(std::move(error_callback)); }}
+{}
+
+StreamController::~StreamController()
+{
+    {
+        std::lock_guard const lock{_mutex};
+        _should_stop = true;
+    }
+    _cv.notify_all();
+    _thread.join();
+}
+
+void StreamController::post(std::function<void(RtAudio&)> task)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    {
+        std::lock_guard const lock{_mutex};
+        _tasks.push_back(std::move(task));
+    }
+    _cv.notify_all();
+}
+
+void StreamController::open(std::function<bool(RtAudio&)> is_up_to_date, std::function<bool(RtAudio&)> try_open)
+{
+    post([this, is_up_to_date = std::move(is_up_to_date), try_open = std::move(try_open)](RtAudio& backend) mutable {
+        if (is_up_to_date(backend))
+        {
+            _pending_open.reset();
+            _state.store(backend.isStreamOpen() ? StreamState::Running : StreamState::Closed, std::memory_order_release); // Usually a no-op, we don't want the state to flicker when nothing changes.
+            return;
+        }
+        _pending_open = PendingOpen{std::move(try_open)};
+        attempt_to_open(backend);
+    });
+}
+
+void StreamController::close()
+{
+    post([this](RtAudio& backend) {
+        _pending_open.reset();
+        if (backend.isStreamOpen())
+            backend.closeStream();
+        _state.store(StreamState::Closed, std::memory_order_release);
+    });
+}
+
+void StreamController::wait_until_idle()
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    std::unique_lock lock{_mutex};
+    _cv.wait(lock, [&]() { return _tasks.empty() && !_is_running_a_task; });
+}
+
+auto StreamController::is_time_for_periodic_check() -> bool
+{
+    auto const current_state = state();
+    if (current_state == StreamState::Opening || current_state == StreamState::Retrying)
+        return false; // Don't cancel the attempts that are in progress.
+
+    auto const now = std::chrono::steady_clock::now();
+    if (now < _next_periodic_check)
+        return false;
+    _next_periodic_check = now + periodic_check_interval;
+    return true;
+}
+
+void StreamController::attempt_to_open(RtAudio& backend)
+{
+    AUDIO_TRACE_SCOPE("Opening a stream");
+    _state.store(StreamState::Opening, std::memory_order_release);
+    if (_pending_open->try_open(backend))
+    {
+        _pending_open.reset();
+        _state.store(backend.isStreamOpen() ? StreamState::Running : StreamState::Closed, std::memory_order_release); // `try_open` can succeed without opening anything, e.g. if there was nothing to play.
+        return;
+    }
+
+    _pending_open->failed_attempts_count++;
+    if (_pending_open->failed_attempts_count >= max_attempts_count)
+    {
+        _pending_open.reset();
+        _state.store(StreamState::Failed, std::memory_order_release);
+        return;
+    }
+
+    auto const delay                 = std::min(first_retry_delay * (1 << (_pending_open->failed_attempts_count - 1)), max_retry_delay); // Exponential backoff
+    _pending_open->next_attempt_time = std::chrono::steady_clock::now() + delay;
+    _state.store(StreamState::Retrying, std::memory_order_release);
+}
+
+void StreamController::control_thread_loop(RtAudioErrorCallback error_callback)
+{
+    RtAudio backend{RtAudio::Api::UNSPECIFIED, std::move(error_callback)};
+
+    std::unique_lock lock{_mutex};
+    while (true)
+    {
+        auto const has_work = [&]() { return _should_stop || !_tasks.empty(); };
+        if (_pending_open)
+            _cv.wait_until(lock, _pending_open->next_attempt_time, has_work);
+        else
+            _cv.wait(lock, has_work);
+
+        if (!_tasks.empty())
+        {
+            auto task = std::move(_tasks.front());
+            _tasks.pop_front();
+            _is_running_a_task = true;
+            lock.unlock(); // Don't block the other threads while we are doing the slow work.
+            task(backend);
+            lock.lock();
+            _is_running_a_task = false;
+            _cv.notify_all(); // Wake up `wait_until_idle()`
+            continue;
+        }
+
+        if (_should_stop) // Only once all the tasks have been executed.
+            break;
+
+        if (_pending_open && std::chrono::steady_clock::now() >= _pending_open->next_attempt_time)
+        {
+            lock.unlock();
+            attempt_to_open(backend);
+            lock.lock();
+        }
+    }
+    lock.unlock();
+
+    if (backend.isStreamOpen())
+        backend.closeStream();
+    _state.store(StreamState::Closed, std::memory_order_release);
+}
+
+} // namespace Audio
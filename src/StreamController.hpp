@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "rtaudio/RtAudio.h"
+
+namespace Audio {
+
+enum class StreamState {
+    Closed,   // No stream, and we are not trying to open one.
+    Opening,  // An attempt to open the stream is in progress.
+    Running,  // The last attempt to open the stream succeeded.
+    Retrying, // The last attempt failed, another one is scheduled.
+    Failed,   // All the attempts failed, we gave up until the next call to `open()`.
+};
+
+/// Opening, starting and closing a stream can take tens to hundreds of milliseconds, so we do it on a dedicated control thread in order to never block the main thread.
+/// The controller owns the RtAudio backend, and it must only be used from the control thread, i.e. inside the tasks given to `post()` and `open()`.
+/// (The backend is also created on the control thread, because some APIs (e.g. WASAPI) require it to be used from the thread that created it).
+class StreamController {
+public:
+    /// NB: The errors will be reported on the control thread.
+    explicit StreamController(RtAudioErrorCallback);
+    /// Runs all the tasks that have already been posted, closes the stream, and then joins the control thread.
+    ~StreamController();
+    StreamController(StreamController const&)                        = delete; //
+    auto operator=(StreamController const&) -> StreamController&     = delete; // Can't copy nor move
+    StreamController(StreamController&&) noexcept                    = delete; // because the control thread uses the address of this object.
+    auto operator=(StreamController&&) noexcept -> StreamController& = delete; //
+
+    /// Runs `task` on the control thread, after all the tasks that have been posted before it.
+    void post(std::function<void(RtAudio&)> task);
+    /// Runs `is_up_to_date` on the control thread, and if it returns false runs `try_open`, which must return true iff it succeeded (or if there was nothing to open).
+    /// The state only becomes `StreamState::Opening` once we know that we actually need to reopen the stream.
+    /// If it fails we retry, waiting longer and longer between each attempt, until we give up and the state becomes `StreamState::Failed`.
+    /// Any subsequent call to `open()` or `close()` cancels the pending retries.
+    void open(std::function<bool(RtAudio&)> is_up_to_date, std::function<bool(RtAudio&)> try_open);
+    /// Closes the stream (on the control thread) and cancels the pending retries.
+    void close();
+
+    /// Can be called from any thread.
+    [[nodiscard]] auto state() const -> StreamState { return _state.load(std::memory_order_acquire); }
+    /// Blocks until all the tasks that have been posted so far have been executed. Doesn't wait for the pending retries.
+    void wait_until_idle();
+    /// Returns true every few seconds, unless an attempt to open the stream is in progress.
+    /// The owner of the stream should then call `open()` again even if its devices haven't changed, so that a stream that has `Failed` or has been stopped by the backend is eventually reopened.
+    /// /!\ Must always be called from the same thread.
+    [[nodiscard]] auto is_time_for_periodic_check() -> bool;
+
+private:
+    void control_thread_loop(RtAudioErrorCallback);
+    void attempt_to_open(RtAudio&);
+
+private:
+    struct PendingOpen {
+        std::function<bool(RtAudio&)>         try_open;
+        int                                   failed_attempts_count{0};
+        std::chrono::steady_clock::time_point next_attempt_time{};
+    };
+
+    std::atomic<StreamState> _state{StreamState::Closed};
+
+    std::mutex                                _mutex{};
+    std::condition_variable                   _cv{};
+    std::deque<std::function<void(RtAudio&)>> _tasks{};
+    bool                                      _is_running_a_task{false};
+    bool                                      _should_stop{false};
+    std::optional<PendingOpen>                _pending_open{}; // Only used on the control thread.
+
+    std::chrono::steady_clock::time_point _next_periodic_check{}; // Only used by the thread that calls is_time_for_periodic_check().
+
+    std::thread _thread; // Must be declared last, so that it starts after all the other members are initialized.
+};
+
+} // namespace Audio
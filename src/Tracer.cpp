@@ -0,0 +1,214 @@
+#include "Tracer.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+namespace Audio {
+
+// Plain integers, so that they can be used from operator new even while the thread is starting or exiting.
+static thread_local uint64_t thread_allocations_count{0};
+static thread_local uint64_t thread_allocated_bytes{0};
+static thread_local uint32_t thread_realtime_scopes_count{0};
+
+static std::atomic<uint64_t> total_allocations_count{0};
+static std::atomic<uint64_t> total_allocated_bytes{0};
+
+auto current_thread_allocations() -> AllocationsStats
+{
+    return {.count = thread_allocations_count, .bytes = thread_allocated_bytes};
+}
+
+auto total_allocations() -> AllocationsStats
+{
+    return {.count = total_allocations_count.load(std::memory_order_relaxed), .bytes = total_allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+/// Gives a small index to each thread, which is more readable than the system ids in the trace viewers.
+static auto current_thread_index() -> uint32_t
+{
+    static std::atomic<uint32_t> next_index{0};
+    static thread_local uint32_t index{next_index.fetch_add(1, std::memory_order_relaxed)};
+    return index;
+}
+
+Tracer::~Tracer()
+{
+    stop();
+}
+
+void Tracer::start(size_t max_events_count)
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    stop(); // Other threads can't be using `_slots` after this.
+
+    _slots = std::vector<Slot>(max_events_count);
+    _next_slot_index.store(0, std::memory_order_release);
+    _dropped_events_count.store(0, std::memory_order_release);
+    _start_time = std::chrono::steady_clock::now();
+    _is_recording.store(true, std::memory_order_seq_cst);
+}
+
+void Tracer::stop()
+{
+    // Same handshake as with `Recorder::push_interleaved()`: once the counter is back to 0, no other thread can be using `_slots`.
+    _is_recording.store(false, std::memory_order_seq_cst);
+    while (_records_in_progress.load(std::memory_order_seq_cst) != 0)
+        std::this_thread::yield(); // Recording an event only copies a few bytes, it will be over in a few nanoseconds.
+}
+
+void Tracer::record(TraceEvent const& event)
+{
+    _records_in_progress.fetch_add(1, std::memory_order_seq_cst);
+    if (_is_recording.load(std::memory_order_seq_cst))
+    {
+        auto const index = _next_slot_index.fetch_add(1, std::memory_order_relaxed);
+        if (index < _slots.size())
+        {
+            _slots[index].event = event;
+            _slots[index].is_complete.store(true, std::memory_order_release);
+        }
+        else
+        {
+            _dropped_events_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    _records_in_progress.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+auto Tracer::events_count() const -> size_t
+{
+    return std::min(_next_slot_index.load(std::memory_order_acquire), _slots.size());
+}
+
+static auto microseconds(std::chrono::steady_clock::duration duration) -> double
+{
+    return std::chrono::duration<double, std::micro>{duration}.count();
+}
+
+static void write_json_string(std::ostream& out, char const* string)
+{
+    out << '"';
+    for (char const* c = string; *c != '\0'; ++c) // NOLINT(*pointer-arithmetic)
+    {
+        if (*c == '"' || *c == '\\')
+            out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+void Tracer::write_chrome_trace(std::filesystem::path const& path) const
+{
+    AUDIO_ASSERT_NOT_REALTIME();
+    auto file = std::ofstream{path};
+    if (!file)
+        throw std::runtime_error{"Failed to create \"" + path.string() + "\""};
+
+    // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool is_first{true};
+    for (size_t i = 0; i < events_count(); ++i)
+    {
+        if (!_slots[i].is_complete.load(std::memory_order_acquire))
+            continue;
+        auto const& event = _slots[i].event;
+        if (!is_first)
+            file << ',';
+        is_first = false;
+        file << "\n{\"name\":";
+        write_json_string(file, event.name);
+        file << ",\"cat\":\"Audio\",\"ph\":\"X\",\"pid\":0"
+             << ",\"tid\":" << event.thread_index
+             << ",\"ts\":" << microseconds(event.begin - _start_time)
+             << ",\"dur\":" << microseconds(event.duration)
+             << ",\"args\":{\"allocations\":" << event.allocations.count << ",\"allocated_bytes\":" << event.allocations.bytes << "}}";
+    }
+    file << "\n]}\n";
+    if (!file)
+        throw std::runtime_error{"Failed to write \"" + path.string() + "\""};
+}
+
+auto tracer() -> Tracer&
+{
+    static auto instance = Tracer{};
+    return instance;
+}
+
+ScopedTrace::ScopedTrace(char const* name)
+    : _name{name}
+    , _begin{std::chrono::steady_clock::now()}
+    , _allocations_at_begin{current_thread_allocations()}
+{}
+
+ScopedTrace::~ScopedTrace()
+{
+    auto const allocations = current_thread_allocations();
+    tracer().record({
+        .name         = _name,
+        .begin        = _begin,
+        .duration     = std::chrono::steady_clock::now() - _begin,
+        .allocations  = {.count = allocations.count - _allocations_at_begin.count, .bytes = allocations.bytes - _allocations_at_begin.bytes},
+        .thread_index = current_thread_index(),
+    });
+}
+
+RealtimeScope::RealtimeScope()
+{
+    ++thread_realtime_scopes_count;
+}
+
+RealtimeScope::~RealtimeScope()
+{
+    --thread_realtime_scopes_count;
+}
+
+auto is_in_realtime_scope() -> bool
+{
+    return thread_realtime_scopes_count != 0;
+}
+
+} // namespace Audio
+
+#if defined(AUDIO_ENABLE_TRACING) || defined(AUDIO_CHECKS_REALTIME_SAFETY)
+namespace Audio {
+
+static void on_allocation(size_t bytes)
+{
+    assert(thread_realtime_scopes_count == 0 && "The audio thread must not allocate.");
+    ++thread_allocations_count;
+    thread_allocated_bytes += bytes;
+    total_allocations_count.fetch_add(1, std::memory_order_relaxed);
+    total_allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+} // namespace Audio
+
+// Replacing these is enough to see all the allocations: the array and nothrow versions call them by default.
+// (Except the over-aligned versions, which are rare enough that we don't bother).
+auto operator new(std::size_t size) -> void*
+{
+    Audio::on_allocation(size);
+    while (true)
+    {
+        if (void* ptr = std::malloc(size == 0 ? 1 : size)) // NOLINT(*no-malloc, *owning-memory)
+            return ptr;
+        auto const new_handler = std::get_new_handler();
+        if (!new_handler)
+            throw std::bad_alloc{};
+        new_handler();
+    }
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr); // NOLINT(*no-malloc, *owning-memory)
+}
+
+void operator delete(void* ptr, std::size_t /* size */) noexcept
+{
+    std::free(ptr); // NOLINT(*no-malloc, *owning-memory)
+}
+#endif
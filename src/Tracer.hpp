@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Instrumentation of the library.
+// Everything in here is compiled out unless you enable it with the CMake options:
+//  - AUDIO_ENABLE_TRACING: measures the time and the allocations of our public functions and audio callbacks, and lets you export them with `tracer().write_chrome_trace()`.
+//  - AUDIO_ENABLE_REALTIME_SAFETY_CHECKS: in debug builds, asserts if the audio thread allocates or calls one of our functions that can block.
+// NB: both options replace the global operator new (to be able to count the allocations), so they can't be used if your application already replaces it.
+
+#define AUDIO_TRACER_CONCAT_IMPL(a, b) a##b
+#define AUDIO_TRACER_CONCAT(a, b)      AUDIO_TRACER_CONCAT_IMPL(a, b)
+
+#if defined(AUDIO_ENABLE_TRACING)
+/// Measures the time spent (and the allocations made) until the end of the current scope. `name` MUST be a string literal.
+#define AUDIO_TRACE_SCOPE(name) Audio::ScopedTrace const AUDIO_TRACER_CONCAT(audio_trace_scope_, __LINE__){name}
+#else
+#define AUDIO_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+#if defined(AUDIO_ENABLE_REALTIME_SAFETY_CHECKS) && !defined(NDEBUG)
+#define AUDIO_CHECKS_REALTIME_SAFETY 1
+/// Must be put at the beginning of the audio callbacks: until the end of the scope, allocations and blocking calls will trigger an assert.
+#define AUDIO_REALTIME_SCOPE()      Audio::RealtimeScope const AUDIO_TRACER_CONCAT(audio_realtime_scope_, __LINE__){}
+/// Must be put in the functions that can block (e.g. because they lock a mutex), so that calling them from the audio thread triggers an assert.
+#define AUDIO_ASSERT_NOT_REALTIME() assert(!Audio::is_in_realtime_scope() && "This function can block, it must not be called on the audio thread.")
+#else
+#define AUDIO_REALTIME_SCOPE()      static_cast<void>(0)
+#define AUDIO_ASSERT_NOT_REALTIME() static_cast<void>(0)
+#endif
+
+namespace Audio {
+
+struct AllocationsStats {
+    uint64_t count{0};
+    uint64_t bytes{0};
+};
+
+/// The allocations made by the current thread since it started.
+/// Always 0 unless one of the instrumentation options is enabled, because we need to replace the global operator new to count them.
+[[nodiscard]] auto current_thread_allocations() -> AllocationsStats;
+/// The allocations made by all the threads since the application started.
+/// Always 0 unless one of the instrumentation options is enabled, because we need to replace the global operator new to count them.
+[[nodiscard]] auto total_allocations() -> AllocationsStats;
+
+struct TraceEvent {
+    char const*                           name{};
+    std::chrono::steady_clock::time_point begin{};
+    std::chrono::steady_clock::duration   duration{};
+    AllocationsStats                      allocations{}; // Made by this thread during the event
+    uint32_t                              thread_index{};
+};
+
+/// Collects the events measured by `ScopedTrace`.
+/// Recording an event never allocates nor locks, so it can be done on the audio thread: the events are written in a buffer that is allocated once in `start()`.
+class Tracer {
+public:
+    Tracer() = default;
+    ~Tracer();
+    Tracer(Tracer const&)                        = delete; //
+    auto operator=(Tracer const&) -> Tracer&     = delete; // Can't copy nor move
+    Tracer(Tracer&&) noexcept                    = delete; // because other threads might be recording events in it.
+    auto operator=(Tracer&&) noexcept -> Tracer& = delete; //
+
+    /// Forgets the previous events and starts recording new ones.
+    /// At most `max_events_count` events are kept, the following ones are dropped (see `dropped_events_count()`).
+    void start(size_t max_events_count = 1'000'000);
+    /// Stops recording. The events that have been recorded are kept until the next call to `start()`.
+    void stop();
+    [[nodiscard]] auto is_recording() const -> bool { return _is_recording.load(std::memory_order_acquire); }
+
+    /// Can be called from any thread. Does nothing if we are not recording.
+    void record(TraceEvent const&);
+
+    [[nodiscard]] auto events_count() const -> size_t;
+    [[nodiscard]] auto dropped_events_count() const -> uint64_t { return _dropped_events_count.load(std::memory_order_acquire); }
+
+    /// Writes the events recorded so far in the Chrome trace event format (JSON).
+    /// You can open it in https://ui.perfetto.dev or chrome://tracing, or convert it with the `import-chrome` tool of Tracy.
+    /// /!\ Must be called on the same thread as `start()`.
+    /// Throws an exception if the file can't be written.
+    void write_chrome_trace(std::filesystem::path const&) const;
+
+private:
+    struct Slot {
+        TraceEvent        event{};
+        std::atomic<bool> is_complete{false}; // So that we don't export an event that is still being written.
+    };
+
+    std::vector<Slot>                     _slots{};
+    std::atomic<size_t>                   _next_slot_index{0};
+    std::atomic<uint64_t>                 _dropped_events_count{0};
+    std::atomic<bool>                     _is_recording{false};
+    std::atomic<uint32_t>                 _records_in_progress{0}; // So that start() can wait until no other thread uses `_slots` anymore.
+    std::chrono::steady_clock::time_point _start_time{};
+};
+
+/// The tracer used by `AUDIO_TRACE_SCOPE()`.
+auto tracer() -> Tracer&;
+
+/// Records an event in `tracer()` that lasts from its construction to its destruction.
+class ScopedTrace {
+public:
+    /// `name` MUST outlive the tracer (i.e. it should be a string literal).
+    explicit ScopedTrace(char const* name);
+    ~ScopedTrace();
+    ScopedTrace(ScopedTrace const&)                        = delete; // Can't copy nor move
+    auto operator=(ScopedTrace const&) -> ScopedTrace&     = delete; // because it measures the scope
+    ScopedTrace(ScopedTrace&&) noexcept                    = delete; // it has been created in.
+    auto operator=(ScopedTrace&&) noexcept -> ScopedTrace& = delete; //
+
+private:
+    char const*                           _name;
+    std::chrono::steady_clock::time_point _begin;
+    AllocationsStats                      _allocations_at_begin;
+};
+
+/// Marks the current thread as a real-time thread until the end of the scope (see `AUDIO_REALTIME_SCOPE()`).
+class RealtimeScope {
+public:
+    RealtimeScope();
+    ~RealtimeScope();
+    RealtimeScope(RealtimeScope const&)                        = delete; // Can't copy nor move
+    auto operator=(RealtimeScope const&) -> RealtimeScope&     = delete; // because it marks the scope
+    RealtimeScope(RealtimeScope&&) noexcept                    = delete; // it has been created in.
+    auto operator=(RealtimeScope&&) noexcept -> RealtimeScope& = delete; //
+};
+
+/// True iff the current thread is inside a `RealtimeScope`.
+[[nodiscard]] auto is_in_realtime_scope() -> bool;
+
+} // namespace Audio
@@ -1,10 +1,12 @@
 #include "compute_volume.hpp"
 #include <cmath>
+#include "Tracer.hpp"
 
 namespace Audio {
 
 auto compute_volume(std::span<float const> data) -> float
 {
+    AUDIO_TRACE_SCOPE("compute_volume");
     if (data.empty())
         return 0.f;
     // TODO(Audio) Implement a much smarter loudness computation like https://github.com/klangfreund/LUFSMeter/tree/master
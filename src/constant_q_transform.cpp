@@ -0,0 +1,115 @@
+#include "constant_q_transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "Tracer.hpp"
+#include "fft.hpp"
+#include "next_power_of_two.hpp"
+
+namespace Audio {
+
+static constexpr float TAU = 6.2831853071f;
+
+// Implementation of "An efficient algorithm for the calculation of a constant Q transform", Brown and Puckette, 1992.
+// Each constant-Q bin is the dot product of the signal with a windowed complex sinusoid (its temporal kernel).
+// By Parseval's theorem this is also the dot product of their FFTs, and the FFT of a kernel (its spectral kernel) is almost zero everywhere except around its frequency.
+// So we precompute the sparse spectral kernels once, and then each frame only costs one FFT of the signal plus a few multiplications per bin.
+ConstantQKernel::ConstantQKernel(ConstantQSettings const& settings, float audio_data_sample_rate)
+    : _settings{settings}
+{
+    AUDIO_TRACE_SCOPE("ConstantQKernel");
+    auto const bins_per_octave = static_cast<float>(settings.bins_per_octave);
+    auto const Q               = 1.f / (std::pow(2.f, 1.f / bins_per_octave) - 1.f);
+    auto const window_size     = [&](float frequency) { // The lower the frequency, the longer the window needs to be to have the same Q.
+        return static_cast<size_t>(std::ceil(Q * audio_data_sample_rate / frequency));
+    };
+    _fft_size = next_power_of_two(window_size(settings.min_frequency_in_hz));
+
+    auto temporal_kernel = std::vector<std::complex<float>>(_fft_size);
+    for (unsigned int k = 0; k < settings.bins_per_octave * settings.octaves_count; ++k)
+    {
+        auto const frequency = settings.min_frequency_in_hz * std::pow(2.f, static_cast<float>(k) / bins_per_octave);
+        if (frequency >= audio_data_sample_rate / 2.f)
+            break;
+
+        // Hamming-windowed complex sinusoid, centered in the frame so that all the bins are aligned on the same instant.
+        auto const N      = window_size(frequency);
+        auto const offset = (_fft_size - N) / 2;
+        std::fill(temporal_kernel.begin(), temporal_kernel.end(), std::complex<float>{0.f});
+        for (size_t n = 0; n < N; ++n)
+        {
+            auto const t                = static_cast<float>(n) / static_cast<float>(N);
+            auto const window           = 0.54f - 0.46f * std::cos(TAU * t);
+            temporal_kernel[offset + n] = window / static_cast<float>(N) * std::polar(1.f, TAU * Q * t);
+        }
+
+        auto const spectral_kernel = fft(temporal_kernel);
+        // The threshold is relative to the peak of the kernel, so that it doesn't depend on the frequency nor on the scaling of the FFT.
+        auto const peak = std::abs(*std::max_element(spectral_kernel.begin(), spectral_kernel.end(), [](std::complex<float> a, std::complex<float> b) {
+            return std::norm(a) < std::norm(b);
+        }));
+        for (size_t bin = 0; bin < spectral_kernel.size(); ++bin)
+        {
+            if (std::abs(spectral_kernel[bin]) <= settings.sparsity_threshold * peak)
+                continue;
+            _fft_bins.push_back(static_cast<uint32_t>(bin));
+            _values.push_back(std::conj(spectral_kernel[bin])); // `fft()` is unitary (scaled by 1 / sqrt(N)), so by Parseval's theorem the dot product of the spectra is directly the dot product of the signals (no need to divide by N like in the original paper).
+        }
+        _bin_offsets.push_back(_fft_bins.size());
+    }
+}
+
+auto constant_q_transform(ForEachSample const& for_each_sample, ConstantQKernel const& kernel) -> ConstantQSpectrum
+{
+    AUDIO_TRACE_SCOPE("constant_q_transform");
+    auto fft_input = std::vector<std::complex<float>>{};
+    fft_input.reserve(kernel.samples_count());
+    {
+        AUDIO_TRACE_SCOPE("for_each_sample");
+        for_each_sample([&](float const sample) {
+            fft_input.emplace_back(sample);
+        });
+    }
+    assert(fft_input.size() <= kernel.samples_count());
+    fft_input.resize(kernel.samples_count());
+
+    auto const fft_output = fft(fft_input);
+
+    auto spectrum = ConstantQSpectrum{{}, kernel._settings.min_frequency_in_hz, kernel._settings.bins_per_octave};
+    spectrum.data.reserve(kernel.bins_count());
+    for (size_t k = 0; k < kernel.bins_count(); ++k)
+    {
+        auto value = std::complex<float>{0.f};
+        for (size_t i = kernel._bin_offsets[k]; i < kernel._bin_offsets[k + 1]; ++i)
+            value += fft_output[kernel._fft_bins[i]] * kernel._values[i];
+        spectrum.data.push_back(std::abs(value));
+    }
+    return spectrum;
+}
+
+auto constant_q_transform(std::span<float const> audio_data, ConstantQKernel const& kernel) -> ConstantQSpectrum
+{
+    return constant_q_transform(
+        [&](std::function<void(float)> const& callback) {
+            for (float const sample : audio_data)
+                callback(sample);
+        },
+        kernel
+    );
+}
+
+auto ConstantQSpectrum::frequency_of_bin(size_t bin_index) const -> float
+{
+    return min_frequency_in_hz * std::pow(2.f, static_cast<float>(bin_index) / static_cast<float>(bins_per_octave));
+}
+
+auto ConstantQSpectrum::at_frequency(float frequency_in_hertz) const -> float
+{
+    assert(frequency_in_hertz > 0.f);
+    auto const bin = std::round(static_cast<float>(bins_per_octave) * std::log2(frequency_in_hertz / min_frequency_in_hz));
+    if (bin < 0.f || bin >= static_cast<float>(data.size()))
+        return 0.f;
+    return data[static_cast<size_t>(bin)];
+}
+
+} // namespace Audio
@@ -0,0 +1,67 @@
+#pragma once
+#include <complex>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "fourier_transform.hpp"
+
+namespace Audio {
+
+struct ConstantQSettings {
+    /// Frequency of the first bin. The default is C1.
+    float        min_frequency_in_hz{32.7032f};
+    /// 12 gives one bin per semitone.
+    unsigned int bins_per_octave{12};
+    unsigned int octaves_count{8};
+    /// Values of each spectral kernel smaller than this fraction of its peak are dropped. Higher values make `constant_q_transform()` faster but less precise.
+    float        sparsity_threshold{0.0054f};
+};
+
+struct ConstantQSpectrum {
+    /// Amplitudes of each frequency, where the first frequency is `min_frequency_in_hz` and each next frequency is 2^(1 / bins_per_octave) times the previous one.
+    std::vector<float> data{};
+    /// In Hz
+    float              min_frequency_in_hz{};
+    unsigned int       bins_per_octave{};
+
+    /// In Hz
+    [[nodiscard]] auto frequency_of_bin(size_t bin_index) const -> float;
+    /// Evaluates the spectrum at the given frequency (in Hertz) and returns the amplitude of the closest bin.
+    [[nodiscard]] auto at_frequency(float frequency_in_hertz) const -> float;
+};
+
+/// Precomputed spectral kernels used by `constant_q_transform()`.
+/// Creating it is expensive (it computes one FFT per bin), so create it once and reuse it for every frame (as long as the settings and the sample rate don't change).
+class ConstantQKernel {
+public:
+    ConstantQKernel(ConstantQSettings const&, float audio_data_sample_rate);
+
+    /// The number of samples that `constant_q_transform()` expects. It is imposed by the lowest frequency: the lower it is, the more samples we need to resolve it.
+    [[nodiscard]] auto samples_count() const -> size_t { return _fft_size; }
+    /// Bins that would be above the Nyquist frequency (half of the sample rate) are dropped, so this can be less than `bins_per_octave * octaves_count`.
+    [[nodiscard]] auto bins_count() const -> size_t { return _bin_offsets.size() - 1; }
+    [[nodiscard]] auto settings() const -> ConstantQSettings const& { return _settings; }
+
+private:
+    friend auto constant_q_transform(ForEachSample const&, ConstantQKernel const&) -> ConstantQSpectrum;
+
+    ConstantQSettings _settings;
+    size_t            _fft_size{};
+
+    /// Sparse matrix stored row by row (one row per constant-Q bin): the kernel of bin `k` is made of the FFT bins `_fft_bins[_bin_offsets[k]]` to `_fft_bins[_bin_offsets[k + 1] - 1]`, multiplied by the corresponding `_values`.
+    std::vector<size_t>              _bin_offsets{0};
+    std::vector<uint32_t>            _fft_bins{};
+    std::vector<std::complex<float>> _values{};
+};
+
+/// Computes the constant-Q transform of the given signal: unlike `fourier_transform()`, its bins are spaced geometrically (e.g. one per semitone), which matches musical notes.
+/// It costs about one FFT (of size `kernel.samples_count()`) plus a sparse product, whatever the number of bins.
+/// `for_each_sample` must give (at most) `kernel.samples_count()` samples. If it gives less, we will zero-pad the audio data.
+/// NB: You don't need to apply a window function yourself, the kernels already contain one.
+auto constant_q_transform(ForEachSample const& for_each_sample, ConstantQKernel const& kernel) -> ConstantQSpectrum;
+
+/// Computes the constant-Q transform of the given `audio_data` signal.
+/// `audio_data` should contain `kernel.samples_count()` samples.
+auto constant_q_transform(std::span<float const> audio_data, ConstantQKernel const& kernel) -> ConstantQSpectrum;
+
+} // namespace Audio
@@ -0,0 +1,36 @@
+#include "fft.hpp"
+#include <span>
+#include "FixedSizeFft.hpp"
+#include "Tracer.hpp"
+#include "dj_fft.h"
+
+namespace Audio {
+
+template<size_t N>
+static auto fixed_size_fft(std::vector<std::complex<float>> const& data) -> std::vector<std::complex<float>>
+{
+    auto result = data;
+    FixedSizeFft<N>::transform(std::span<std::complex<float>, N>{result.data(), N});
+    return result;
+}
+
+auto fft(std::vector<std::complex<float>> const& data) -> std::vector<std::complex<float>>
+{
+    AUDIO_TRACE_SCOPE("fft");
+    // The sizes that we use the most get a version that is specialized at compile time.
+    switch (data.size())
+    {
+    case 1024:
+        return fixed_size_fft<1024>(data);
+    case 2048:
+        return fixed_size_fft<2048>(data);
+    case 4096:
+        return fixed_size_fft<4096>(data);
+    case 8192:
+        return fixed_size_fft<8192>(data);
+    default:
+        return dj::fft1d(data, dj::fft_dir::DIR_FWD);
+    }
+}
+
+} // namespace Audio
@@ -0,0 +1,11 @@
+#pragma once
+#include <complex>
+#include <vector>
+
+namespace Audio {
+
+/// Computes the forward FFT of `data`.
+/// The size of `data` MUST be a power of two.
+auto fft(std::vector<std::complex<float>> const& data) -> std::vector<std::complex<float>>;
+
+} // namespace Audio
@@ -1,26 +1,14 @@
 #include "fourier_transform.hpp"
 #include <algorithm>
+#include <cassert>
 #include <complex>
 #include <vector>
-#include "dj_fft.h"
+#include "Tracer.hpp"
+#include "fft.hpp"
+#include "next_power_of_two.hpp"
 
 namespace Audio {
 
-template<std::integral T>
-static auto next_power_of_two(T n) -> T
-{
-    if (n != 0 && !(n & (n - 1)))
-        return n; // n is already a power of 2
-
-    T power = 1;
-    while (power < n)
-    {
-        power <<= 1;
-    }
-
-    return power;
-}
-
 /// Since the FFT requires a size that is a power of two, we add 0s at the end of the data.
 /// https://mechanicalvibration.com/Zero_Padding_FFTs.html
 static void zero_pad(std::vector<std::complex<float>>& data)
@@ -28,20 +16,29 @@ static void zero_pad(std::vector<std::complex<float>>& data)
     data.resize(next_power_of_two(data.size()));
 }
 
-auto fourier_transform(size_t samples_count, ForEachSample const& for_each_sample, float audio_data_sample_rate, float max_frequency_in_hz) -> Spectrum
+static auto compute_fft(size_t samples_count, ForEachSample const& for_each_sample) -> std::vector<std::complex<float>>
 {
     // Create a vector of complex numbers containing the audio data
     auto fft_input = std::vector<std::complex<float>>{};
     fft_input.reserve(next_power_of_two(samples_count));
-    for_each_sample([&](float const sample) {
-        fft_input.emplace_back(sample);
-    });
+    {
+        AUDIO_TRACE_SCOPE("for_each_sample");
+        for_each_sample([&](float const sample) {
+            fft_input.emplace_back(sample);
+        });
+    }
 
     // Make sure the size of fft_input is a power of 2.
     zero_pad(fft_input);
 
     // Compute the fft
-    auto        fft_output = dj::fft1d(fft_input, dj::fft_dir::DIR_FWD);
+    return fft(fft_input);
+}
+
+auto fourier_transform(size_t samples_count, ForEachSample const& for_each_sample, float audio_data_sample_rate, float max_frequency_in_hz) -> Spectrum
+{
+    AUDIO_TRACE_SCOPE("fourier_transform");
+    auto        fft_output = compute_fft(samples_count, for_each_sample);
     float const delta_between_frequencies{audio_data_sample_rate / static_cast<float>(fft_output.size())}; // The values in the `fft_output` correspond to frequencies between 0 and sample_rate, evenly spaced.
 
     // TODO(Audio) Instead of computing the fft on a signal with many samples, and then resizing it to fit the requested `max_output_frequency_in_hz`, we could reduce it's sample rate before computing the fft, to minimize the number of frequencies that are computed for nothing (since they will be discarded afterwards anyways).
@@ -80,6 +77,24 @@ auto fourier_transform(std::span<float const> audio_data, float audio_data_sampl
     );
 }
 
+auto fourier_transform(size_t samples_count, ForEachSample const& for_each_sample, FrequencyBands const& bands) -> std::vector<float>
+{
+    AUDIO_TRACE_SCOPE("fourier_transform");
+    assert(next_power_of_two(samples_count) == bands.fft_size());
+    return bands.apply(compute_fft(samples_count, for_each_sample));
+}
+
+auto fourier_transform(std::span<float const> audio_data, FrequencyBands const& bands) -> std::vector<float>
+{
+    return fourier_transform(
+        audio_data.size(), [&](std::function<void(float)> const& callback) {
+            for (float const sample : audio_data)
+                callback(sample);
+        },
+        bands
+    );
+}
+
 auto Spectrum::at_frequency(float frequency_in_hertz) const -> float
 {
     assert(frequency_in_hertz >= 0.f);
@@ -1,6 +1,7 @@
 #pragma once
 #include <functional>
 #include <span>
+#include "frequency_bands.hpp"
 
 namespace Audio {
 
@@ -30,4 +31,14 @@ auto fourier_transform(size_t samples_count, ForEachSample const& for_each_sampl
 /// NB: If the `samples_count` is not a power of two, we will zero-pad the `audio_data` to reach the next power of two: https://mechanicalvibration.com/Zero_Padding_FFTs.html
 auto fourier_transform(std::span<float const> audio_data, float audio_data_sample_rate, float max_frequency_in_hz = -1.f) -> Spectrum;
 
+/// Computes the fourier transform of the given signal, and directly aggregates it into the perceptual bands described by `bands` (mel, 1/3-octave, log-spaced, etc.).
+/// This is cheaper than calling the other overload and then re-binning the `Spectrum` yourself, because the full linear spectrum is never stored.
+/// `bands` MUST have been created with the same `samples_count` and sample rate.
+/// Returns the amplitude of each band, ordered from the lowest to the highest frequency (see `FrequencyBands::center_frequencies()`).
+auto fourier_transform(size_t samples_count, ForEachSample const& for_each_sample, FrequencyBands const& bands) -> std::vector<float>;
+
+/// Computes the fourier transform of the given `audio_data` signal, and directly aggregates it into the perceptual bands described by `bands`.
+/// `bands` MUST have been created with `audio_data.size()` as its `samples_count`.
+auto fourier_transform(std::span<float const> audio_data, FrequencyBands const& bands) -> std::vector<float>;
+
 } // namespace Audio
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "frequency_bands.hpp"
+#include <algorithm>
+#include <cmath>
+#include "Tracer.hpp"
+#include "next_power_of_two.hpp"
+
+namespace Audio {
+
+namespace {
+struct Band {
+    float lower;
+    float center;
+    float upper;
+    bool  is_triangular;
+};
+struct BinWeight {
+    size_t   bin_index;
+    uint32_t band_index;
+    float    weight;
+};
+} // namespace
+
+static auto mel_from_hz(float frequency_in_hz) -> float
+{
+    return 2595.f * std::log10(1.f + frequency_in_hz / 700.f);
+}
+
+static auto hz_from_mel(float mel) -> float
+{
+    return 700.f * (std::pow(10.f, mel / 2595.f) - 1.f);
+}
+
+static auto make_bands(MelBands const& layout, float max_frequency_in_hz) -> std::vector<Band>
+{
+    auto       bands   = std::vector<Band>{};
+    auto const mel_min = mel_from_hz(layout.min_frequency_in_hz);
+    auto const mel_max = mel_from_hz(std::min(layout.max_frequency_in_hz, max_frequency_in_hz));
+    // Each triangle goes from the center of the previous one to the center of the next one, so we need 2 more points than there are bands.
+    auto const step = (mel_max - mel_min) / static_cast<float>(layout.bands_count + 1);
+    for (size_t i = 0; i < layout.bands_count; ++i)
+    {
+        auto const mel = mel_min + static_cast<float>(i) * step;
+        bands.push_back({hz_from_mel(mel), hz_from_mel(mel + step), hz_from_mel(mel + 2.f * step), true});
+    }
+    return bands;
+}
+
+static auto make_bands(ThirdOctaveBands const& layout, float max_frequency_in_hz) -> std::vector<Band>
+{
+    auto       bands      = std::vector<Band>{};
+    auto const max_freq   = std::min(layout.max_frequency_in_hz, max_frequency_in_hz);
+    auto const half_third = std::pow(2.f, 1.f / 6.f);
+    // Centers are 1000 * 2^(k/3), so we look for all the k whose center lies in [min_freq, max_freq].
+    // We round instead of truncating because the standard bands are named after rounded values: e.g. the "20 Hz" band is actually centered on 19.7 Hz, and the "20 kHz" one on 20.2 kHz.
+    auto const first_k = static_cast<int>(std::round(3.f * std::log2(layout.min_frequency_in_hz / 1000.f)));
+    auto const last_k  = static_cast<int>(std::round(3.f * std::log2(max_freq / 1000.f)));
+    for (int k = first_k; k <= last_k; ++k)
+    {
+        auto const center = 1000.f * std::pow(2.f, static_cast<float>(k) / 3.f);
+        if (center > max_frequency_in_hz) // Can happen because of the rounding, but we can't measure anything above the Nyquist frequency.
+            break;
+        bands.push_back({center / half_third, center, center * half_third, false});
+    }
+    return bands;
+}
+
+static auto make_bands(LogBands const& layout, float max_frequency_in_hz) -> std::vector<Band>
+{
+    auto       bands    = std::vector<Band>{};
+    auto const min_freq = layout.min_frequency_in_hz;
+    auto const max_freq = std::min(layout.max_frequency_in_hz, max_frequency_in_hz);
+    auto const edge     = [&](size_t i) {
+        return min_freq * std::pow(max_freq / min_freq, static_cast<float>(i) / static_cast<float>(layout.bands_count));
+    };
+    for (size_t i = 0; i < layout.bands_count; ++i)
+    {
+        auto const lower = edge(i);
+        auto const upper = edge(i + 1);
+        bands.push_back({lower, std::sqrt(lower * upper), upper, false});
+    }
+    return bands;
+}
+
+static auto weight(Band const& band, float frequency) -> float
+{
+    if (!band.is_triangular)
+        return frequency >= band.lower && frequency < band.upper ? 1.f : 0.f;
+    if (frequency <= band.lower || frequency >= band.upper)
+        return 0.f;
+    if (frequency <= band.center)
+        return (frequency - band.lower) / (band.center - band.lower);
+    return (band.upper - frequency) / (band.upper - band.center);
+}
+
+FrequencyBands::FrequencyBands(BandsLayout const& layout, size_t samples_count, float audio_data_sample_rate)
+    : _fft_size{next_power_of_two(samples_count)}
+{
+    AUDIO_TRACE_SCOPE("FrequencyBands");
+    auto const bins_count   = _fft_size / 2; // The second half of the fft is a mirror of the first half.
+    auto const bin_width    = audio_data_sample_rate / static_cast<float>(_fft_size);
+    auto const nyquist      = audio_data_sample_rate / 2.f;
+    auto const bands        = std::visit([&](auto const& l) { return make_bands(l, nyquist); }, layout);
+    auto       bins_weights = std::vector<BinWeight>{};
+    auto const bin_of       = [&](float frequency) {
+        return std::min(static_cast<size_t>(std::max(frequency / bin_width, 0.f)), bins_count - 1);
+    };
+
+    _center_frequencies.reserve(bands.size());
+    for (uint32_t band_index = 0; band_index < bands.size(); ++band_index)
+    {
+        auto const& band = bands[band_index];
+        _center_frequencies.push_back(band.center);
+
+        bool has_weights{false};
+        for (size_t bin = bin_of(band.lower); bin <= bin_of(band.upper); ++bin)
+        {
+            auto const w = weight(band, static_cast<float>(bin) * bin_width);
+            if (w <= 0.f)
+                continue;
+            bins_weights.push_back({bin, band_index, w});
+            has_weights = true;
+        }
+        // Low-frequency bands can be narrower than a bin. Instead of leaving them empty, we give them the value of the closest bin.
+        if (!has_weights)
+            bins_weights.push_back({bin_of(band.center + bin_width / 2.f), band_index, 1.f});
+    }
+
+    // Store the weights sorted by bin, so that `apply()` can go through the bins in order and compute each amplitude only once.
+    std::stable_sort(bins_weights.begin(), bins_weights.end(), [](BinWeight const& a, BinWeight const& b) {
+        return a.bin_index < b.bin_index;
+    });
+    auto const used_bins_count = bins_weights.empty() ? 0 : bins_weights.back().bin_index + 1;
+    _bin_offsets.assign(used_bins_count + 1, 0);
+    _weights.reserve(bins_weights.size());
+    for (auto const& w : bins_weights)
+    {
+        _weights.push_back({w.band_index, w.weight});
+        ++_bin_offsets[w.bin_index + 1];
+    }
+    for (size_t i = 1; i < _bin_offsets.size(); ++i)
+        _bin_offsets[i] += _bin_offsets[i - 1];
+}
+
+auto FrequencyBands::apply(std::span<std::complex<float> const> fft_output) const -> std::vector<float>
+{
+    AUDIO_TRACE_SCOPE("FrequencyBands::apply");
+    auto       bands      = std::vector<float>(bands_count(), 0.f);
+    auto const bins_count = std::min(_bin_offsets.size() - 1, fft_output.size());
+    for (size_t bin = 0; bin < bins_count; ++bin)
+    {
+        auto const begin = _bin_offsets[bin];
+        auto const end   = _bin_offsets[bin + 1];
+        if (begin == end)
+            continue;
+        auto const energy = std::norm(fft_output[bin]); // Squared amplitude
+        for (size_t i = begin; i < end; ++i)
+            bands[_weights[i].band_index] += _weights[i].weight * energy;
+    }
+    for (float& band : bands)
+        band = std::sqrt(band);
+    return bands;
+}
+
+} // namespace Audio
@@ -0,0 +1,64 @@
+#pragma once
+#include <complex>
+#include <cstdint>
+#include <span>
+#include <variant>
+#include <vector>
+
+namespace Audio {
+
+/// Triangular filters evenly spaced on the mel scale, which mimics the way humans perceive pitch.
+struct MelBands {
+    size_t bands_count{40};
+    float  min_frequency_in_hz{20.f};
+    float  max_frequency_in_hz{20000.f};
+};
+
+/// The standard 1/3-octave bands (centered on 1000 Hz * 2^(k/3), and named after the rounded values 20 Hz, 25 Hz, 31.5 Hz, ..., 20 kHz) that lie between `min_frequency_in_hz` and `max_frequency_in_hz`.
+struct ThirdOctaveBands {
+    float min_frequency_in_hz{20.f};
+    float max_frequency_in_hz{20000.f};
+};
+
+/// `bands_count` bands whose edges are evenly spaced on a logarithmic scale.
+struct LogBands {
+    size_t bands_count{32};
+    float  min_frequency_in_hz{20.f};
+    float  max_frequency_in_hz{20000.f};
+};
+
+using BandsLayout = std::variant<MelBands, ThirdOctaveBands, LogBands>;
+
+/// Turns the linearly-spaced bins of a fourier transform into a few perceptual bands.
+/// All the weights are precomputed in the constructor, so create it once and reuse it for every frame (as long as the layout, the number of samples and the sample rate don't change).
+/// Each band is the square root of the weighted sum of the energies (squared amplitudes) of the bins it covers.
+/// So a pure tone gives a value close to its peak in `Spectrum::data`, even though the window function spreads it over a few bins, and a band doesn't get quieter just because it is wide.
+class FrequencyBands {
+public:
+    /// `samples_count` and `audio_data_sample_rate` MUST be the ones that you will pass to `fourier_transform()`.
+    FrequencyBands(BandsLayout const&, size_t samples_count, float audio_data_sample_rate);
+
+    [[nodiscard]] auto bands_count() const -> size_t { return _center_frequencies.size(); }
+    /// In Hz. For bands with hard edges (1/3-octave and log) this is the geometric mean of the two edges.
+    [[nodiscard]] auto center_frequencies() const -> std::vector<float> const& { return _center_frequencies; }
+    /// The size of the FFT these weights have been computed for (i.e. `samples_count` rounded up to the next power of two).
+    [[nodiscard]] auto fft_size() const -> size_t { return _fft_size; }
+
+    /// Computes the amplitude of each bin of `fft_output` and accumulates it directly into the bands, without ever storing the full spectrum.
+    /// Only the bins that contribute to at least one band are read.
+    [[nodiscard]] auto apply(std::span<std::complex<float> const> fft_output) const -> std::vector<float>;
+
+private:
+    struct Weight {
+        uint32_t band_index;
+        float    weight;
+    };
+
+    /// Sparse matrix stored row by row (one row per bin): the weights of bin `i` are `_weights[_bin_offsets[i]]` to `_weights[_bin_offsets[i + 1] - 1]`.
+    std::vector<size_t> _bin_offsets{};
+    std::vector<Weight> _weights{};
+    std::vector<float>  _center_frequencies{};
+    size_t              _fft_size{};
+};
+
+} // namespace Audio
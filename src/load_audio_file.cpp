@@ -1,24 +1,33 @@
 #include "load_audio_file.hpp"
+#include "Tracer.hpp"
 #include "libnyquist/Common.h"
 #include "libnyquist/Decoders.h"
 
 namespace Audio {
 
-auto load_audio_file(std::filesystem::path const& path) -> AudioData
+auto load_audio_file(std::filesystem::path const& path, SampleStorage storage, SeekTableMode seek_table_mode) -> AudioData
 {
+    AUDIO_TRACE_SCOPE("load_audio_file");
     nqr::NyquistIO io;
     nqr::AudioData data;
     io.Load(&data, path.string());
-    return {
-        std::move(data.samples),
-        static_cast<unsigned int>(data.sampleRate),
-        static_cast<unsigned int>(data.channelCount),
+    auto res = AudioData{
+        .samples        = std::move(data.samples),
+        .sample_rate    = static_cast<unsigned int>(data.sampleRate),
+        .channels_count = static_cast<unsigned int>(data.channelCount),
     };
+    if (storage == SampleStorage::Int16)
+        res.compact();
+    if (seek_table_mode == SeekTableMode::Build)
+        res.seek_table = std::make_shared<SeekTable const>(build_seek_table(path));
+    else if (seek_table_mode == SeekTableMode::Cached)
+        res.seek_table = cached_seek_table(path);
+    return res;
 }
 
-void load_audio_file(Player& player, std::filesystem::path const& path)
+void load_audio_file(Player& player, std::filesystem::path const& path, SampleStorage storage, SeekTableMode seek_table_mode)
 {
-    player.set_audio_data(load_audio_file(path));
+    player.set_audio_data(load_audio_file(path, storage, seek_table_mode));
 }
 
 } // namespace Audio
@@ -5,8 +5,12 @@
 namespace Audio {
 
 /// Throws an exception if the loading fails (e.g. if the file is not found).
-auto load_audio_file(std::filesystem::path const&) -> AudioData;
+/// Use `SampleStorage::Int16` to halve the memory used by the samples (e.g. if you preload many tracks).
+/// Use `SeekTableMode::Build` or `SeekTableMode::Cached` to also fill `AudioData::seek_table` (see `build_seek_table()`).
+auto load_audio_file(std::filesystem::path const&, SampleStorage = SampleStorage::Float32, SeekTableMode = SeekTableMode::None) -> AudioData;
 /// Throws an exception if the loading fails (e.g. if the file is not found).
-void load_audio_file(Player&, std::filesystem::path const&);
+/// Use `SampleStorage::Int16` to halve the memory used by the samples (e.g. if you preload many tracks).
+/// Use `SeekTableMode::Build` or `SeekTableMode::Cached` to also fill `AudioData::seek_table` (see `build_seek_table()`).
+void load_audio_file(Player&, std::filesystem::path const&, SampleStorage = SampleStorage::Float32, SeekTableMode = SeekTableMode::None);
 
-} // namespace Audio
\ No newline at end of file
+} // namespace Audio
@@ -0,0 +1,21 @@
+#pragma once
+#include <concepts>
+
+namespace Audio {
+
+template<std::integral T>
+auto next_power_of_two(T n) -> T
+{
+    if (n != 0 && !(n & (n - 1)))
+        return n; // n is already a power of 2
+
+    T power = 1;
+    while (power < n)
+    {
+        power <<= 1;
+    }
+
+    return power;
+}
+
+} // namespace Audio
@@ -2,7 +2,9 @@
 #include <Audio/Audio.hpp>
 #include <algorithm>
 #include <complex>
+#include <fstream>
 #include <iterator>
+#include <numbers>
 #include <quick_imgui/quick_imgui.hpp>
 #include "imgui.h"
 
@@ -48,14 +50,15 @@ auto main(int argc, char* argv[]) -> int
     };
     static constexpr size_t nb_samples_in_input_stream{512};
     input_stream.set_nb_of_retained_samples(nb_samples_in_input_stream);
-    // Load the audio file
-    Audio::load_audio_file(Audio::player(), exe_path::dir() / "../tests/res/Monteverdi - L'Orfeo, Toccata.mp3");
+    // Load the audio file (in the background, the player will start once it is loaded)
+    Audio::player().set_audio_data(Audio::audio_loader().load(exe_path::dir() / "../tests/res/Monteverdi - L'Orfeo, Toccata.mp3"));
     Audio::player().play();
 
     static constexpr int64_t fft_size{8000};
     float                    max_spectrum_frequency_in_hz{15000.f};
 
     quick_imgui::loop("Audio tests", [&]() { // Open a window and run all the ImGui-related code
+        Audio::player().update();
         auto const spectrum = Audio::fourier_transform(
             fft_size,
             [&](std::function<void(float)> const& callback) {
@@ -124,6 +127,18 @@ auto main(int argc, char* argv[]) -> int
             -0.1f, 0.1f,
             {0.f, 100.f}
         );
+        if (!input_stream.recorder().is_recording())
+        {
+            if (ImGui::Button("Start recording"))
+                input_stream.start_recording(exe_path::dir() / "recording.wav");
+        }
+        else
+        {
+            if (ImGui::Button("Stop recording"))
+                input_stream.stop_recording();
+            ImGui::SameLine();
+            ImGui::Text("%llu frames written, %llu dropped", static_cast<unsigned long long>(input_stream.recorder().written_frames_count()), static_cast<unsigned long long>(input_stream.recorder().dropped_frames_count()));
+        }
         //
         ImGui::End();
         ImGui::ShowDemoWindow();
@@ -137,6 +152,21 @@ TEST_CASE("At least one API has been compiled")
     Audio::Player player{}; // This will assert if no API is available, which is something we want to detect.
 }
 
+TEST_CASE("Several players can coexist")
+{
+    Audio::Player music{};
+    Audio::Player cue{};
+    Audio::load_audio_file(music, exe_path::dir() / "../tests/res/Monteverdi - L'Orfeo, Toccata.mp3");
+    Audio::load_audio_file(cue, exe_path::dir() / "../tests/res/10-1000-10000-20000.wav");
+    music.play();
+    cue.play();
+    music.pause(); // So that the output stream doesn't move them forward while we check their time
+    cue.pause();
+    CHECK(music.set_time(1.));
+    CHECK(music.get_time() == doctest::Approx(1.));
+    CHECK(cue.get_time() < 0.5); // Each player has its own transport
+}
+
 TEST_CASE("Loading a .wav file")
 {
     Audio::load_audio_file(Audio::player(), exe_path::dir() / "../tests/res/10-1000-10000-20000.wav");
@@ -155,6 +185,85 @@ TEST_CASE("Loading a .mp3 file")
     CHECK(Audio::player().audio_data().samples.size() == 9819648);
 }
 
+TEST_CASE("Seek table of a .wav file")
+{
+    auto const data  = Audio::load_audio_file(exe_path::dir() / "../tests/res/10-1000-10000-20000.wav", Audio::SampleStorage::Float32, Audio::SeekTableMode::Build);
+    auto const table = data.seek_table;
+    REQUIRE(table);
+    CHECK(table->frames_count() == 164000);
+    CHECK(table->sample_rate() == 41000);
+    CHECK(table->find(1000) == Audio::SeekPoint{1000, 44 + 1000 * 2});
+    CHECK(table->find_time(1.) == table->find(41000));
+}
+
+TEST_CASE("Seek table of a .mp3 file")
+{
+    auto const path  = exe_path::dir() / "../tests/res/Monteverdi - L'Orfeo, Toccata.mp3";
+    auto const data  = Audio::load_audio_file(path, Audio::SampleStorage::Float32, Audio::SeekTableMode::Cached);
+    auto const table = data.seek_table;
+    REQUIRE(table);
+    CHECK(table->frames_count() * 2 == data.samples_count()); // The scan finds exactly the frames that the decoder outputs.
+    CHECK(table->sample_rate() == 44100);
+    CHECK(table->find(100000).frame_index == 99072); // The start of the MP3 frame (1152 frames each) that contains frame 100000
+    CHECK(table->find(0).frame_index == 0);
+    CHECK(Audio::cached_seek_table(path) == table);
+}
+
+TEST_CASE("Loading files in the background")
+{
+    auto       loader = Audio::AudioLoader{2};
+    auto const wav    = exe_path::dir() / "../tests/res/10-1000-10000-20000.wav";
+    auto const mp3    = exe_path::dir() / "../tests/res/Monteverdi - L'Orfeo, Toccata.mp3";
+
+    auto const futures = loader.load({wav, mp3, exe_path::dir() / "../tests/res/does-not-exist.wav"});
+    REQUIRE(futures.size() == 3);
+    CHECK(futures[0].get()->samples_count() == 164000);
+    CHECK(futures[1].get()->samples_count() == 9819648);
+    CHECK_THROWS(futures[2].get());
+
+    // Already in the cache, so it is shared instead of being decoded again.
+    CHECK(loader.load(wav).get() == futures[0].get());
+    CHECK(loader.memory_usage() == (164000 + 9819648) * sizeof(float)); // Already up to date when the futures become ready.
+
+    // The wav has just been requested, so the mp3 is the least recently used one.
+    loader.set_memory_budget(164000 * sizeof(float));
+    CHECK(loader.memory_usage() == 164000 * sizeof(float));
+    CHECK(loader.load(wav).get() == futures[0].get());
+    CHECK(futures[1].get()->samples_count() == 9819648); // Evicting only drops the reference of the cache.
+
+    Audio::Player player{};
+    player.set_audio_data(loader.load(wav));
+    while (player.is_loading_audio_data())
+        player.update();
+    CHECK(&player.audio_data() == futures[0].get().get());
+}
+
+TEST_CASE("Loading a file with compact storage")
+{
+    auto const data = Audio::load_audio_file(exe_path::dir() / "../tests/res/Monteverdi - L'Orfeo, Toccata.mp3", Audio::SampleStorage::Int16);
+
+    CHECK(data.storage() == Audio::SampleStorage::Int16);
+    CHECK(data.samples.empty());
+    CHECK(data.compact_samples.size() == 9819648);
+    CHECK(data.samples_count() == 9819648);
+}
+
+TEST_CASE("Compact storage")
+{
+    auto data = Audio::AudioData{.samples = {0.f, 0.5f, -1.f, 1.f, 0.25f, -0.3f}, .sample_rate = 44100, .channels_count = 2};
+    data.compact();
+    CHECK(data.storage() == Audio::SampleStorage::Int16);
+    CHECK(data.samples_count() == 6);
+
+    auto decoded = std::vector<float>(4);
+    data.read_samples(2, decoded);
+    CHECK(decoded[0] == doctest::Approx(-1.f).epsilon(0.0001));
+    CHECK(decoded[1] == doctest::Approx(1.f).epsilon(0.0001));
+    CHECK(decoded[2] == doctest::Approx(0.25f).epsilon(0.0001));
+    CHECK(decoded[3] == doctest::Approx(-0.3f).epsilon(0.0001));
+    CHECK(data.sample(1) == doctest::Approx(0.5f).epsilon(0.0001));
+}
+
 static auto is_big(float x) -> bool
 {
     return x > 5.f;
@@ -198,4 +307,297 @@ TEST_CASE("Fourier transform")
     CHECK(is_small(spectrum.at_frequency(500.f)));
     CHECK(is_small(spectrum.at_frequency(5000.f)));
     CHECK(is_small(spectrum.at_frequency(15000.f)));
-}
\ No newline at end of file
+}
+
+TEST_CASE("FixedSizeFft matches the definition of the Fourier transform")
+{
+    static constexpr size_t size = 1024;
+
+    auto data  = std::array<std::complex<float>, size>{};
+    auto input = std::vector<std::complex<double>>(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        auto const t = static_cast<double>(i);
+        input[i]     = {std::sin(0.37 * t) + 0.1 * std::cos(3.1 * t), 0.2 * std::sin(1.7 * t)};
+        data[i]      = std::complex<float>{input[i]};
+    }
+    Audio::FixedSizeFft<size>::transform(data);
+
+    for (size_t k = 0; k < size; ++k)
+    {
+        auto expected = std::complex<double>{0.};
+        for (size_t n = 0; n < size; ++n)
+            expected += input[n] * std::polar(1., 2. * std::numbers::pi * static_cast<double>((k * n) % size) / static_cast<double>(size));
+        expected /= std::sqrt(static_cast<double>(size));
+        CHECK(std::abs(expected - std::complex<double>{data[k]}) < 0.0001);
+    }
+}
+
+TEST_CASE("Fourier transform aggregated into frequency bands")
+{
+    static constexpr int64_t sample_rate = 44000;
+    static constexpr int64_t fft_size    = 8000;
+
+    auto const bands = Audio::FrequencyBands{Audio::ThirdOctaveBands{}, fft_size, static_cast<float>(sample_rate)};
+    auto const data  = Audio::fourier_transform(
+        fft_size, [&](std::function<void(float)> const& callback) {
+            for (int64_t i = 0; i < fft_size; i++)
+            {
+                float time = static_cast<float>(i) / static_cast<float>(sample_rate);
+                callback(window(i, fft_size) * std::sin(1000.f * time * TAU)); // 1000Hz frequency
+            }
+        },
+        bands
+    );
+
+    auto const band_at = [&](float center_frequency) {
+        auto const& centers = bands.center_frequencies();
+        auto const  it      = std::find_if(centers.begin(), centers.end(), [&](float f) { return std::abs(f - center_frequency) < 1.f; });
+        REQUIRE(it != centers.end());
+        return data[static_cast<size_t>(std::distance(centers.begin(), it))];
+    };
+
+    REQUIRE(data.size() == bands.bands_count());
+    CHECK(bands.center_frequencies().front() == doctest::Approx(19.69f).epsilon(0.01)); // The standard "20 Hz" band
+    CHECK(is_big(band_at(1000.f)));
+    CHECK(is_small(band_at(250.f)));
+    CHECK(is_small(band_at(4000.f)));
+}
+
+TEST_CASE("Constant-Q transform")
+{
+    static constexpr float sample_rate = 44100.f;
+
+    auto const kernel   = Audio::ConstantQKernel{{.min_frequency_in_hz = 65.406f /* C2 */, .bins_per_octave = 12, .octaves_count = 6}, sample_rate};
+    auto const spectrum = Audio::constant_q_transform(
+        [&](std::function<void(float)> const& callback) {
+            for (size_t i = 0; i < kernel.samples_count(); i++)
+            {
+                float time = static_cast<float>(i) / sample_rate;
+                callback(std::sin(440.f * time * TAU)); // A4
+            }
+        },
+        kernel
+    );
+
+    CHECK(spectrum.data.size() == 72);
+    CHECK(spectrum.at_frequency(440.f) == doctest::Approx(0.27f).epsilon(0.05)); // Half the amplitude of the sine, times the mean of the Hamming window
+    CHECK(is_small(spectrum.at_frequency(220.f)));
+    CHECK(is_small(spectrum.at_frequency(880.f)));
+    CHECK(is_small(spectrum.at_frequency(600.f)));
+}
+
+TEST_CASE("Constant-Q transform gives the same results whichever FFT implementation is used")
+{
+    static constexpr float sample_rate = 44100.f;
+
+    auto const transform = [&](Audio::ConstantQKernel const& kernel) {
+        return Audio::constant_q_transform(
+            [&](std::function<void(float)> const& callback) {
+                for (size_t i = 0; i < kernel.samples_count(); i++)
+                {
+                    float time = static_cast<float>(i) / sample_rate;
+                    callback(std::sin(440.f * time * TAU)); // A4
+                }
+            },
+            kernel
+        );
+    };
+
+    // Same bins, except that the second kernel has one more octave at the bottom, which needs a bigger FFT.
+    auto const small_kernel = Audio::ConstantQKernel{{.min_frequency_in_hz = 110.f, .bins_per_octave = 12, .octaves_count = 4}, sample_rate};
+    auto const big_kernel   = Audio::ConstantQKernel{{.min_frequency_in_hz = 55.f, .bins_per_octave = 12, .octaves_count = 5}, sample_rate};
+    REQUIRE(small_kernel.samples_count() == 8192); // Uses FixedSizeFft
+    REQUIRE(big_kernel.samples_count() == 16384);  // Uses dj::fft1d
+
+    auto const small_spectrum = transform(small_kernel);
+    auto const big_spectrum   = transform(big_kernel);
+    REQUIRE(big_spectrum.data.size() == small_spectrum.data.size() + 12);
+    for (size_t i = 0; i < small_spectrum.data.size(); ++i)
+    {
+        CHECK(small_spectrum.frequency_of_bin(i) == doctest::Approx(big_spectrum.frequency_of_bin(i + 12)));
+        CHECK(std::abs(small_spectrum.data[i] - big_spectrum.data[i + 12]) < 0.01f);
+    }
+}
+
+TEST_CASE("RingBuffer deinterleaves the channels and keeps the latest samples")
+{
+    auto buffer = Audio::RingBuffer{};
+    buffer.reset(2, 10); // Capacity will be rounded up to 16
+
+    auto interleaved = std::vector<float>{};
+    for (int i = 0; i < 40; ++i)
+    {
+        interleaved.push_back(static_cast<float>(i));  // Channel 0
+        interleaved.push_back(static_cast<float>(-i)); // Channel 1
+    }
+
+    auto latest = std::vector<float>(6);
+    buffer.push_interleaved(interleaved.data(), 4);
+    CHECK(buffer.read_latest(latest, 1));
+    CHECK(latest == std::vector<float>{0.f, 0.f, 0.f, -1.f, -2.f, -3.f}); // Not enough samples yet, the beginning is filled with 0s
+
+    buffer.push_interleaved(interleaved.data() + 8, 36); // NOLINT(*pointer-arithmetic)
+    CHECK(buffer.read_latest(latest, 0));
+    CHECK(latest == std::vector<float>{34.f, 35.f, 36.f, 37.f, 38.f, 39.f}); // Oldest samples have been overwritten
+}
+
+TEST_CASE("Recorder writes a .wav file that can be loaded back")
+{
+    auto const path   = std::filesystem::temp_directory_path() / "Audio-tests-recording.wav";
+    auto       frames = std::vector<float>{};
+    for (int i = 0; i < 1000; ++i)
+    {
+        frames.push_back(static_cast<float>(i) / 1000.f);
+        frames.push_back(-static_cast<float>(i) / 1000.f);
+    }
+
+    Audio::Recorder recorder{};
+    recorder.start(path, Audio::RecordingFormat::Wav, 2, 48000);
+    CHECK(recorder.is_recording());
+    for (size_t i = 0; i < frames.size(); i += 200) // Push it in small blocks, like the audio callback does
+        recorder.push_interleaved(&frames[i], 100, 2);
+    recorder.push_interleaved(frames.data(), 100, 1); // Wrong number of channels
+    recorder.stop();
+    CHECK(!recorder.is_recording());
+    CHECK(recorder.written_frames_count() == 1000);
+    CHECK(recorder.dropped_frames_count() == 100);
+    CHECK(!recorder.has_write_error());
+
+    auto const data = Audio::load_audio_file(path);
+    CHECK(data.channels_count == 2);
+    CHECK(data.sample_rate == 48000);
+    CHECK(data.samples == frames);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("PlaybackClock extrapolates smoothly from the latest anchor")
+{
+    using namespace std::chrono_literals;
+    auto       clock = Audio::PlaybackClock{};
+    auto const t0    = std::chrono::steady_clock::now();
+
+    CHECK_FALSE(clock.time_at(t0, 1, 100ms).has_value()); // No anchor yet
+
+    clock.set_anchor(10., t0, 1);
+    CHECK(*clock.time_at(t0 - 20ms, 1, 100ms) == doctest::Approx(9.98)); // Before the anchor becomes audible (because of the latency)
+    CHECK(*clock.time_at(t0 + 50ms, 1, 100ms) == doctest::Approx(10.05));
+    CHECK(*clock.time_at(t0 + 1s, 1, 100ms) == doctest::Approx(10.1)); // Doesn't run away if the audio thread stalls
+    CHECK_FALSE(clock.time_at(t0, 2, 100ms).has_value());              // The transport has changed since the anchor was set
+}
+
+TEST_CASE("DevicesRegistry notifies its listeners when the devices change")
+{
+    std::atomic<unsigned int> default_output_device_id{1};
+    auto                      registry = Audio::DevicesRegistry{[&](RtAudio&) {
+        auto snapshot                     = Audio::DevicesSnapshot{};
+        snapshot.default_output_device_id = default_output_device_id.load();
+        return snapshot;
+    }};
+
+    std::atomic<unsigned int> seen_by_first{0};
+    std::atomic<unsigned int> seen_by_second{0};
+    auto const                first  = registry.subscribe([&](Audio::DevicesSnapshot const& snapshot) { seen_by_first = snapshot.default_output_device_id; });
+    auto const                second = registry.subscribe([&](Audio::DevicesSnapshot const& snapshot) { seen_by_second = snapshot.default_output_device_id; });
+    CHECK(first != second);
+
+    auto const change_default_device_and_wait = [&](unsigned int device_id) {
+        default_output_device_id = device_id;
+        registry.request_refresh();
+        auto const timeout = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+        while (seen_by_second != device_id && std::chrono::steady_clock::now() < timeout)
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        REQUIRE(seen_by_second == device_id);
+    };
+
+    change_default_device_and_wait(2);
+    CHECK(seen_by_first == 2);
+    CHECK(registry.snapshot()->default_output_device_id == 2);
+
+    registry.unsubscribe(first);
+    change_default_device_and_wait(3);
+    CHECK(seen_by_first == 2); // The listeners are called in order, so it would have been called before the second one
+    registry.unsubscribe(second);
+}
+
+TEST_CASE("Processors of a DuplexStream")
+{
+    static constexpr unsigned int sample_rate    = 48000;
+    static constexpr unsigned int channels_count = 2;
+    static constexpr size_t       frames_count   = 4800;
+    auto const                    format         = Audio::StreamFormat{.sample_rate = sample_rate, .channels_count = channels_count, .max_frames_count = frames_count};
+
+    auto const sine = [](float frequency) {
+        auto block = std::vector<float>(frames_count * channels_count);
+        for (size_t frame = 0; frame < frames_count; ++frame)
+        {
+            auto const value = std::sin(frequency * TAU * static_cast<float>(frame) / static_cast<float>(sample_rate));
+            for (size_t channel = 0; channel < channels_count; ++channel)
+                block[frame * channels_count + channel] = value;
+        }
+        return block;
+    };
+
+    SUBCASE("Gain")
+    {
+        auto gain  = Audio::Gain{0.5f};
+        auto block = std::vector<float>{1.f, -1.f, 0.5f, 0.25f};
+        gain.process(block, channels_count);
+        CHECK(block == std::vector<float>{0.5f, -0.5f, 0.25f, 0.125f});
+    }
+
+    SUBCASE("LevelMeter")
+    {
+        auto meter = Audio::LevelMeter{};
+        auto block = sine(1000.f);
+        meter.process(block, channels_count);
+        CHECK(meter.peak() == doctest::Approx(1.f).epsilon(0.01));
+        CHECK(meter.rms() == doctest::Approx(0.7071f).epsilon(0.01));
+    }
+
+    SUBCASE("BiquadFilter")
+    {
+        auto const level_after_low_pass = [&](float frequency) {
+            auto filter = Audio::BiquadFilter{{.type = Audio::BiquadType::LowPass, .frequency_in_hz = 1000.f}};
+            auto meter  = Audio::LevelMeter{};
+            filter.prepare(format);
+            auto block = sine(frequency);
+            filter.process(block, channels_count);
+            meter.process(block, channels_count);
+            return meter.rms();
+        };
+        CHECK(level_after_low_pass(100.f) == doctest::Approx(0.7071f).epsilon(0.05)); // Passes through
+        CHECK(level_after_low_pass(10000.f) < 0.05f);                                 // Gets attenuated
+    }
+}
+
+TEST_CASE("Tracer exports the recorded events as a Chrome trace")
+{
+    auto const path = std::filesystem::temp_directory_path() / "Audio-tests-trace.json";
+
+    // Uses its own tracer instead of the global one, which might also be recording the events of the other threads of the library.
+    auto       tracer = Audio::Tracer{};
+    auto const event  = [](char const* name) {
+        return Audio::TraceEvent{.name = name, .begin = std::chrono::steady_clock::now(), .duration = std::chrono::microseconds{10}};
+    };
+    tracer.start(2);
+    tracer.record(event("Inner"));
+    tracer.record(event("Outer"));
+    tracer.record(event("Dropped")); // The tracer is full
+    tracer.stop();
+    tracer.record(event("Ignored")); // The tracer is not recording anymore
+    CHECK(tracer.events_count() == 2);
+    CHECK(tracer.dropped_events_count() == 1);
+
+    tracer.write_chrome_trace(path);
+    auto const json = [&]() {
+        auto file = std::ifstream{path};
+        return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }();
+    CHECK(json.find("\"traceEvents\"") != std::string::npos);
+    CHECK(json.find("\"name\":\"Outer\"") != std::string::npos);
+    CHECK(json.find("\"name\":\"Inner\"") != std::string::npos);
+    CHECK(json.find("Dropped") == std::string::npos);
+    CHECK(json.find("Ignored") == std::string::npos);
+    std::filesystem::remove(path);
+}